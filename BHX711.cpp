@@ -1,489 +1,1205 @@
-//
-//    FILE: HX711.cpp
-//  AUTHOR: Rob Tillaart
-// VERSION: 0.3.9
-// PURPOSE: Library for load cells for UNO
-//     URL: https://github.com/RobTillaart/HX711
-
-
-#include "BHX711.h"
-#include "kalman.h"
-
-BHX711::BHX711()
-{
-  reset();
-}
-
-
-BHX711::~BHX711()
-{
-}
-
-
-void BHX711::begin(uint8_t dataPin, uint8_t clockPin)
-{
-  _dataPin  = dataPin;
-  _clockPin = clockPin;
-
-  pinMode(_dataPin, INPUT);
-  pinMode(_clockPin, OUTPUT);
-  digitalWrite(_clockPin, LOW);
-
-  reset();
-  // init Kalman filter
-  KalmanInit();
-  // let's do some dummy thrust reading
-  // to initialise the Kalman filter
-  for (int i = 0; i < 50; i++) {
-    kalman_read();
-  }
-}
-
-
-void BHX711::reset()
-{
-  power_down();
-  power_up();
-  _offset   = 0;
-  _scale    = 1;
-  _gain     = HX711_CHANNEL_A_GAIN_128;
-  _lastRead = 0;
-  _mode     = HX711_AVERAGE_MODE;
-}
-
-
-bool BHX711::is_ready()
-{
-  return digitalRead(_dataPin) == LOW;
-}
-
-
-void BHX711::wait_ready(uint32_t ms)
-{
-  while (!is_ready())
-  {
-    delay(ms);
-  }
-}
-
-
-bool BHX711::wait_ready_retry(uint8_t retries, uint32_t ms)
-{
-  while (retries--)
-  {
-    if (is_ready()) return true;
-    delay(ms);
-  }
-  return false;
-}
-
-
-bool BHX711::wait_ready_timeout(uint32_t timeout, uint32_t ms)
-{
-  uint32_t start = millis();
-  while (millis() - start < timeout)
-  {
-    if (is_ready()) return true;
-    delay(ms);
-  }
-  return false;
-}
-
-
-///////////////////////////////////////////////////////////
-//
-//  READ
-//
-//  From datasheet page 4
-//  When output data is not ready for retrieval,
-//       digital output pin DOUT is HIGH.
-//  Serial clock input PD_SCK should be LOW.
-//  When DOUT goes to LOW, it indicates data is ready for retrieval.
-float BHX711::read()
-{
-  //  this BLOCKING wait takes most time...
-  while (digitalRead(_dataPin) == HIGH) yield();
-
-  union
-  {
-    long value = 0;
-    uint8_t data[4];
-  } v;
-
-  //  blocking part ...
-  noInterrupts();
-
-  //  Pulse the clock pin 24 times to read the data.
-  //  v.data[2] = shiftIn(_dataPin, _clockPin, MSBFIRST);
-  //  v.data[1] = shiftIn(_dataPin, _clockPin, MSBFIRST);
-  //  v.data[0] = shiftIn(_dataPin, _clockPin, MSBFIRST);
-  v.data[2] = _shiftIn();
-  v.data[1] = _shiftIn();
-  v.data[0] = _shiftIn();
-
-  //  TABLE 3 page 4 datasheet
-  //
-  //  CLOCK      CHANNEL      GAIN      m
-  //  ------------------------------------
-  //   25           A         128       1    //  default
-  //   26           B          32       2
-  //   27           A          64       3
-  //
-  //  only default 128 verified,
-  //  selection goes through the set_gain(gain)
-  //
-  uint8_t m = 1;
-  if      (_gain == HX711_CHANNEL_A_GAIN_128) m = 1;
-  else if (_gain == HX711_CHANNEL_A_GAIN_64)  m = 3;
-  else if (_gain == HX711_CHANNEL_B_GAIN_32)  m = 2;
-
-  while (m > 0)
-  {
-    //  delayMicroSeconds(1) needed for fast processors?
-    digitalWrite(_clockPin, HIGH);
-    digitalWrite(_clockPin, LOW);
-    m--;
-  }
-
-  interrupts();
-  //  yield();
-
-  //  SIGN extend
-  if (v.data[2] & 0x80) v.data[3] = 0xFF;
-
-  _lastRead = millis();
-  return 1.0 * v.value;
-}
-
-float BHX711::kalman_read() {
-  _last_read_value = read();
-  return KalmanCalc(_last_read_value);
-}
-
-float BHX711::read_average(uint8_t times)
-{
-  if (times < 1) times = 1;
-  float sum = 0;
-  float sum_average = 0;
-  for (uint8_t i = 0; i < times; i++)
-  {
-    //sum += read();
-    sum += kalman_read();
-    sum_average += _last_read_value;
-    yield();
-  }
-  //_last_average_read_value = sum_average / times;
-  //return sum / times;
-  _last_average_read_value = sum / times;
-  return sum_average / times;
-}
-
-
-float BHX711::read_median(uint8_t times)
-{
-  if (times > 15) times = 15;
-  if (times < 3)  times = 3;
-  float samples[15];
-  for (uint8_t i = 0; i < times; i++)
-  {
-    samples[i] = read();
-    yield();
-  }
-  _insertSort(samples, times);
-  if (times & 0x01) return samples[times/2];
-  return (samples[times/2] + samples[times/2 + 1]) / 2;
-}
-
-
-float BHX711::read_medavg(uint8_t times)
-{
-  if (times > 15) times = 15;
-  if (times < 3)  times = 3;
-  float samples[15];
-  for (uint8_t i = 0; i < times; i++)
-  {
-    samples[i] = read();
-    yield();
-  }
-  _insertSort(samples, times);
-  float sum = 0;
-  //  iterate over 1/4 to 3/4 of the array
-  uint8_t count = 0;
-  uint8_t first = (times + 2) / 4;
-  uint8_t last  = times - first - 1;
-  for (uint8_t i = first; i <= last; i++)  //  !! include last one too
-  {
-    sum += samples[i];
-    count++;
-  }
-  return sum / count;
-}
-
-
-float BHX711::read_runavg(uint8_t times, float alpha)
-{
-  if (times < 1)  times = 1;
-  if (alpha < 0)  alpha = 0;
-  if (alpha > 1)  alpha = 1;
-  float val = read();
-  for (uint8_t i = 1; i < times; i++)
-  {
-    val += alpha * (read() - val);
-    yield();
-  }
-  return val;
-}
-
-
-///////////////////////////////////////////////////////
-//
-//  MODE
-//
-void BHX711::set_raw_mode()
-{
-  _mode = HX711_RAW_MODE;
-}
-
-
-void BHX711::set_average_mode()
-{
-  _mode = HX711_AVERAGE_MODE;
-}
-
-
-void BHX711::set_median_mode()
-{
-  _mode = HX711_MEDIAN_MODE;
-}
-
-
-void BHX711::set_medavg_mode()
-{
-  _mode = HX711_MEDAVG_MODE;
-}
-
-
-//  set_run_avg will use a default alpha of 0.5.
-void BHX711::set_runavg_mode()
-{
-  _mode = HX711_RUNAVG_MODE;
-}
-
-
-uint8_t BHX711::get_mode()
-{
-  return _mode;
-}
-
-
-float BHX711::get_value(uint8_t times)
-{
-  float raw;
-  switch(_mode)
-  {
-    case HX711_RAW_MODE:
-      raw = read();
-      break;
-    case HX711_RUNAVG_MODE:
-      raw = read_runavg(times);
-      break;
-    case HX711_MEDAVG_MODE:
-      raw = read_medavg(times);
-      break;
-    case HX711_MEDIAN_MODE:
-      raw = read_median(times);
-      break;
-    case HX711_AVERAGE_MODE:
-    default:
-      raw = read_average(times);
-      
-      break;
-  }
-  return raw - _offset;
-};
-
-
-float BHX711::get_units(uint8_t times)
-{
-  float units = get_value(times) * _scale;
-  return units;
-};
-
-float BHX711::get_units_filtered(){
-  float units = (_last_average_read_value - _offset) * _scale;
-  return units;
-}
-
-
-///////////////////////////////////////////////////////
-//
-//  TARE
-//
-void BHX711::tare(uint8_t times)
-{
-  _offset = read_average(times);
-}
-
-
-float BHX711::get_tare()
-{
-  return -_offset * _scale;
-}
-
-
-bool BHX711::tare_set()
-{
-  return _offset != 0;
-}
-
-
-///////////////////////////////////////////////////////
-//
-//  GAIN
-//
-//  note: if parameter gain == 0xFF40 some compilers
-//  will map that to 0x40 == HX711_CHANNEL_A_GAIN_64;
-//  solution: use uint32_t or larger parameters everywhere.
-//  note that changing gain/channel may take up to 400 ms (page 3)
-bool BHX711::set_gain(uint8_t gain, bool forced)
-{
-  if ( (not forced) && (_gain == gain)) return true;
-  switch(gain)
-  {
-    case HX711_CHANNEL_B_GAIN_32:
-    case HX711_CHANNEL_A_GAIN_64:
-    case HX711_CHANNEL_A_GAIN_128:
-      _gain = gain;
-      read();     //  next user read() is from right channel / gain
-      return true;
-  }
-  return false;   //  unchanged, but incorrect value.
-}
-
-
-uint8_t BHX711::get_gain()
-{
-  return _gain;
-}
-
-
-///////////////////////////////////////////////////////
-//
-//  CALIBRATION AND SETUP
-//
-bool BHX711::set_scale(float scale)
-{
-  if (scale == 0) return false;
-  _scale = 1.0 / scale;
-  return true;
-}
-
-
-float BHX711::get_scale()
-{
-  return 1.0 / _scale;
-}
-
-
-void BHX711::set_offset(long offset)
-{
-  _offset = offset;
-}
-
-
-long BHX711::get_offset()
-{
-  return _offset;
-}
-
-
-//  assumes tare() has been set.
-/*void HX711::calibrate_scale(uint16_t weight, uint8_t times)
-{
-  _scale = (1.0 * weight) / (read_average(times) - _offset);
-}
-*/
-void BHX711::calibrate_scale(float weight, uint8_t times)
-{
-  _scale = (1.0 * weight) / (read_average(times) - _offset);
-}
-
-
-///////////////////////////////////////////////////////
-//
-//  POWER
-//
-void BHX711::power_down()
-{
-  //  at least 60 us HIGH
-  digitalWrite(_clockPin, HIGH);
-  delayMicroseconds(64);
-}
-
-
-void BHX711::power_up()
-{
-  digitalWrite(_clockPin, LOW);
-}
-
-
-///////////////////////////////////////////////////////
-//
-//  MISC
-//
-uint32_t BHX711::last_read()
-{
-  return _lastRead;
-}
-
-
-/////////////////////////////////////////////////////////
-//
-//  PRIVATE
-//
-
-void BHX711::_insertSort(float * array, uint8_t size)
-{
-  uint8_t t, z;
-  float temp;
-  for (t = 1; t < size; t++)
-  {
-    z = t;
-    temp = array[z];
-    while( (z > 0) && (temp < array[z - 1] ))
-    {
-      array[z] = array[z - 1];
-      z--;
-    }
-    array[z] = temp;
-    yield();
-  }
-}
-
-
-//  MSB_FIRST optimized shiftIn
-//  see datasheet page 5 for timing
-uint8_t BHX711::_shiftIn()
-{
-  //  local variables are faster.
-  uint8_t clk   = _clockPin;
-  uint8_t data  = _dataPin;
-  uint8_t value = 0;
-  uint8_t mask  = 0x80;
-  while (mask > 0)
-  {
-    digitalWrite(clk, HIGH);
-    delayMicroseconds(1);   //  T2  >= 0.2 us
-    if (digitalRead(data) == HIGH)
-    {
-      value |= mask;
-    }
-    digitalWrite(clk, LOW);
-    delayMicroseconds(1);   //  keep duty cycle ~50%
-    mask >>= 1;
-  }
-  return value;
-}
-
-
-//  -- END OF FILE --
+//
+//    FILE: HX711.cpp
+//  AUTHOR: Rob Tillaart
+// VERSION: 0.3.9
+// PURPOSE: Library for load cells for UNO
+//     URL: https://github.com/RobTillaart/HX711
+
+
+#include "BHX711.h"
+#include <limits.h>
+#include <stdint.h>
+#if defined ESP32 || defined ARDUINO_ARCH_ESP32
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#endif
+
+
+//  digitalRead() is in the flash on the ESP32, the data ready interrupt
+//  reads the GPIO input registers instead.
+static inline __attribute__((always_inline)) bool _dataLow(uint8_t pin)
+{
+#if defined ESP32 || defined ARDUINO_ARCH_ESP32
+  if (pin < 32) return ((REG_READ(GPIO_IN_REG) >> pin) & 0x01) == 0;
+  return ((REG_READ(GPIO_IN1_REG) >> (pin - 32)) & 0x01) == 0;
+#else
+  return digitalRead(pin) == LOW;
+#endif
+}
+
+BHX711::BHX711()
+{
+  reset();
+}
+
+
+BHX711::~BHX711()
+{
+}
+
+
+void BHX711::begin(uint8_t dataPin, uint8_t clockPin)
+{
+  _dataPin  = dataPin;
+  _clockPin = clockPin;
+
+  pinMode(_dataPin, INPUT);
+  pinMode(_clockPin, OUTPUT);
+  digitalWrite(_clockPin, LOW);
+
+  reset();
+  // init Kalman filter
+  _kalman.reset();
+  // let's do some dummy thrust reading
+  // to initialise the Kalman filter
+  for (int i = 0; i < 50; i++) {
+    kalman_read();
+  }
+}
+
+
+void BHX711::reset()
+{
+  power_down();
+  power_up();
+  _offset   = 0;
+  _scale    = 1;
+  _updateMilliScale();
+  _gain     = HX711_CHANNEL_A_GAIN_128;
+  _lastRead = 0;
+  _mode     = HX711_AVERAGE_MODE;
+}
+
+
+bool HX711_ISR_ATTR BHX711::is_ready()
+{
+#if HX711_MAX_CHANNELS > 1
+  for (uint8_t i = 0; i < _extraCount; i++)
+  {
+    if (!_dataLow(_extraPins[i])) return false;
+  }
+#endif
+  return _dataLow(_dataPin);
+}
+
+
+void BHX711::wait_ready(uint32_t ms)
+{
+  while (!is_ready())
+  {
+    delay(ms);
+  }
+}
+
+
+bool BHX711::wait_ready_retry(uint8_t retries, uint32_t ms)
+{
+  while (retries--)
+  {
+    if (is_ready()) return true;
+    delay(ms);
+  }
+  return false;
+}
+
+
+bool BHX711::wait_ready_timeout(uint32_t timeout, uint32_t ms)
+{
+  uint32_t start = millis();
+  while (millis() - start < timeout)
+  {
+    if (is_ready()) return true;
+    delay(ms);
+  }
+  return false;
+}
+
+
+///////////////////////////////////////////////////////////
+//
+//  READ
+//
+//  From datasheet page 4
+//  When output data is not ready for retrieval,
+//       digital output pin DOUT is HIGH.
+//  Serial clock input PD_SCK should be LOW.
+//  When DOUT goes to LOW, it indicates data is ready for retrieval.
+float BHX711::read()
+{
+  return 1.0 * read_long();
+}
+
+
+long BHX711::read_long()
+{
+  uint32_t start = millis();
+  if (_isrMode)
+  {
+    HX711Sample sample;
+    //  wait for the interrupt routine to queue a conversion
+    while (!_samples.pop(sample))
+    {
+      if (millis() - start > HX711_READ_TIMEOUT) return _readTimeout();
+#if defined ESP32 || defined ARDUINO_ARCH_ESP32
+      //  may run in a high priority task, let the others run
+      delay(1);
+#else
+      yield();
+#endif
+    }
+    _lastRead = sample.time;
+#if HX711_MAX_CHANNELS > 1
+    _extraAccumulate(sample.extra);
+#endif
+    _lastValue = sample.value;
+    return sample.value;
+  }
+
+  //  this BLOCKING wait takes most time...
+  while (!is_ready())
+  {
+    if (millis() - start > HX711_READ_TIMEOUT) return _readTimeout();
+    yield();
+  }
+
+  //  blocking part ...
+  noInterrupts();
+  long value = _readConversion();
+  interrupts();
+  //  yield();
+
+  _lastRead = millis();
+#if HX711_MAX_CHANNELS > 1
+  _extraAccumulate(_extraValue);
+#endif
+  _lastValue = value;
+  return value;
+}
+
+
+//  no conversion came, give the last one again
+long BHX711::_readTimeout()
+{
+  _timeouts++;
+#if HX711_MAX_CHANNELS > 1
+  _extraAccumulate(_extraValue);
+#endif
+  return _lastValue;
+}
+
+float BHX711::kalman_read() {
+#ifdef FIXED_POINT_THRUST
+  long value = read_long();
+  _last_read_value = value;
+  return _kalman.update(value * 16) / 16.0;
+#else
+  _last_read_value = read();
+  return _kalman.update(_last_read_value);
+#endif
+}
+
+float BHX711::read_average(uint8_t times)
+{
+  if (times < 1) times = 1;
+  float sum = 0;
+  float sum_average = 0;
+  for (uint8_t i = 0; i < times; i++)
+  {
+    //sum += read();
+    sum += kalman_read();
+    sum_average += _last_read_value;
+    yield();
+  }
+  //_last_average_read_value = sum_average / times;
+  //return sum / times;
+  _last_average_read_value = sum / times;
+#ifdef FIXED_POINT_THRUST
+  _last_average_filtered = (long)(_last_average_read_value * 16);
+#endif
+  return sum_average / times;
+}
+
+
+float BHX711::read_median(uint8_t times)
+{
+  if (times > 15) times = 15;
+  if (times < 3)  times = 3;
+  float samples[15];
+  for (uint8_t i = 0; i < times; i++)
+  {
+    samples[i] = read();
+    yield();
+  }
+  _insertSort(samples, times);
+  if (times & 0x01) return samples[times/2];
+  return (samples[times/2] + samples[times/2 + 1]) / 2;
+}
+
+
+float BHX711::read_medavg(uint8_t times)
+{
+  if (times > 15) times = 15;
+  if (times < 3)  times = 3;
+  float samples[15];
+  for (uint8_t i = 0; i < times; i++)
+  {
+    samples[i] = read();
+    yield();
+  }
+  _insertSort(samples, times);
+  float sum = 0;
+  //  iterate over 1/4 to 3/4 of the array
+  uint8_t count = 0;
+  uint8_t first = (times + 2) / 4;
+  uint8_t last  = times - first - 1;
+  for (uint8_t i = first; i <= last; i++)  //  !! include last one too
+  {
+    sum += samples[i];
+    count++;
+  }
+  return sum / count;
+}
+
+
+float BHX711::read_runavg(uint8_t times, float alpha)
+{
+  if (times < 1)  times = 1;
+  if (alpha < 0)  alpha = 0;
+  if (alpha > 1)  alpha = 1;
+  float val = read();
+  for (uint8_t i = 1; i < times; i++)
+  {
+    val += alpha * (read() - val);
+    yield();
+  }
+  return val;
+}
+
+
+float BHX711::read_stream_median(uint8_t times)
+{
+  if (times < 1) times = 1;
+  for (uint8_t i = 0; i < times; i++)
+  {
+    _windowPush(read_long());
+    yield();
+  }
+  uint8_t n = _windowCount;
+  if (n & 0x01) return _sorted[n/2];
+  return (_sorted[n/2 - 1] + _sorted[n/2]) / 2.0;
+}
+
+
+float BHX711::read_stream_medavg(uint8_t times)
+{
+  if (times < 1) times = 1;
+  for (uint8_t i = 0; i < times; i++)
+  {
+    _windowPush(read_long());
+    yield();
+  }
+  //  same "middle half" as read_medavg()
+  uint8_t n = _windowCount;
+  uint8_t first = (n + 2) / 4;
+  uint8_t last  = n - first - 1;
+  long sum = 0;
+  for (uint8_t i = first; i <= last; i++)  //  !! include last one too
+  {
+    sum += _sorted[i];
+  }
+  return (float)sum / (last - first + 1);
+}
+
+
+void BHX711::set_window(uint8_t window)
+{
+  if (window > HX711_WINDOW_MAX) window = HX711_WINDOW_MAX;
+  if (window < 3) window = 3;
+  _windowSize = window;
+  clear_window();
+}
+
+
+void BHX711::clear_window()
+{
+  _windowCount  = 0;
+  _windowOldest = 0;
+}
+
+
+float BHX711::read_decimated(uint8_t times)
+{
+  if (times < 1) times = 1;
+  for (uint8_t i = 0; i < times; i++)
+  {
+    long value = read_long();
+    _filterPush(value);
+    _decimatePush(value);
+    yield();
+  }
+  return (float)_decimatedSum / _decimation;
+}
+
+
+void BHX711::set_decimation(uint8_t ratio)
+{
+  if (ratio > HX711_DECIMATE_MAX) ratio = HX711_DECIMATE_MAX;
+  if (ratio < 1) ratio = 1;
+  _decimation = ratio;
+  clear_decimation();
+}
+
+
+void BHX711::set_fir(const int16_t * coefficients, uint8_t taps)
+{
+  if (taps > HX711_FIR_MAX) taps = HX711_FIR_MAX;
+  if (coefficients == NULL) taps = 0;
+  _fir = coefficients;
+  _firTaps = taps;
+  clear_decimation();
+}
+
+
+void BHX711::clear_decimation()
+{
+  _cicIntegrator = 0;
+  _cicIndex = 0;
+  _cicCount = 0;
+  for (uint8_t i = 0; i < HX711_DECIMATE_MAX; i++) _cicComb[i] = 0;
+  _firIndex = 0;
+  _firCount = 0;
+  _decimatedSum = 0;
+}
+
+
+///////////////////////////////////////////////////////
+//
+//  MODE
+//
+void BHX711::set_raw_mode()
+{
+  _mode = HX711_RAW_MODE;
+}
+
+
+void BHX711::set_average_mode()
+{
+  _mode = HX711_AVERAGE_MODE;
+}
+
+
+void BHX711::set_median_mode()
+{
+  _mode = HX711_MEDIAN_MODE;
+}
+
+
+void BHX711::set_medavg_mode()
+{
+  _mode = HX711_MEDAVG_MODE;
+}
+
+
+//  set_run_avg will use a default alpha of 0.5.
+void BHX711::set_runavg_mode()
+{
+  _mode = HX711_RUNAVG_MODE;
+}
+
+
+void BHX711::set_stream_median_mode(uint8_t window)
+{
+  set_window(window);
+  _mode = HX711_STREAM_MEDIAN_MODE;
+}
+
+
+void BHX711::set_stream_medavg_mode(uint8_t window)
+{
+  set_window(window);
+  _mode = HX711_STREAM_MEDAVG_MODE;
+}
+
+
+void BHX711::set_decimate_mode(uint8_t ratio)
+{
+  set_decimation(ratio);
+  _mode = HX711_DECIMATE_MODE;
+}
+
+
+uint8_t BHX711::get_mode()
+{
+  return _mode;
+}
+
+
+float BHX711::get_value(uint8_t times)
+{
+  float raw;
+  switch(_mode)
+  {
+    case HX711_RAW_MODE:
+      raw = read();
+      break;
+    case HX711_RUNAVG_MODE:
+      raw = read_runavg(times);
+      break;
+    case HX711_MEDAVG_MODE:
+      raw = read_medavg(times);
+      break;
+    case HX711_MEDIAN_MODE:
+      raw = read_median(times);
+      break;
+    case HX711_STREAM_MEDIAN_MODE:
+      raw = read_stream_median(times);
+      break;
+    case HX711_STREAM_MEDAVG_MODE:
+      raw = read_stream_medavg(times);
+      break;
+    case HX711_DECIMATE_MODE:
+      raw = read_decimated(times);
+      break;
+    case HX711_AVERAGE_MODE:
+    default:
+      raw = read_average(times);
+      
+      break;
+  }
+  return raw - _offset;
+};
+
+
+float BHX711::get_units(uint8_t times)
+{
+  float units = get_value(times) * _scale;
+  return units;
+};
+
+float BHX711::get_units_filtered(){
+#ifdef FIXED_POINT_THRUST
+  return get_milli_units_filtered() / 1000.0;
+#else
+  float units = (_last_average_read_value - _offset) * _scale;
+  return units;
+#endif
+}
+
+
+//  no float on the way, the raw counts are summed as long and
+//  scaled once, only the truncation of the result differs from
+//  (long)(get_units(times) * 1000)
+long BHX711::get_milli_units(uint8_t times)
+{
+  if (_mode == HX711_DECIMATE_MODE)
+  {
+    if (times < 1) times = 1;
+    for (uint8_t i = 0; i < times; i++)
+    {
+      long value = read_long();
+      _filterPush(value);
+      _decimatePush(value);
+      yield();
+    }
+    return _toMilliUnits(_decimatedSum - (long)_decimation * _offset, _decimation);
+  }
+  if (_mode != HX711_AVERAGE_MODE) return (long)(get_units(times) * 1000);
+  if (times < 1) times = 1;
+  long sum = 0;
+#ifdef FIXED_POINT_THRUST
+  long sum_filtered = 0;
+#else
+  float sum_filtered = 0;
+#endif
+  for (uint8_t i = 0; i < times; i++)
+  {
+    long value = read_long();
+#ifdef FIXED_POINT_THRUST
+    sum_filtered += _kalman.update(value * 16);
+#else
+    sum_filtered += _kalman.update(value);
+#endif
+    sum += value;
+    yield();
+  }
+#ifdef FIXED_POINT_THRUST
+  _last_average_filtered = sum_filtered / times;
+#else
+  _last_average_read_value = sum_filtered / times;
+#endif
+  return _toMilliUnits(sum - (long)times * _offset, times);
+}
+
+
+long BHX711::get_milli_units_filtered()
+{
+#ifdef FIXED_POINT_THRUST
+  return _toMilliUnits(_last_average_filtered - _offset * 16, 16);
+#else
+  return (long)(get_units_filtered() * 1000);
+#endif
+}
+
+
+//  diffSum / times * 1000 / scale, truncated toward 0,
+//  saturated to a long
+long BHX711::_toMilliUnits(long diffSum, uint8_t times)
+{
+  return _toMilliUnits(diffSum, times, _milliScale);
+}
+
+
+long BHX711::_toMilliUnits(long diffSum, uint8_t times, int64_t milliScale)
+{
+  bool negative = (diffSum < 0) != (milliScale < 0);
+  uint64_t count = diffSum < 0 ? -(int64_t)diffSum : diffSum;
+  uint64_t scale = milliScale < 0 ? -milliScale : milliScale;
+  //  an uncalibrated cell has a scale of 1, 1000 << 24
+  if (scale != 0 && count > (uint64_t)INT64_MAX / scale)
+    return negative ? -LONG_MAX : LONG_MAX;
+  uint64_t units = ((count * scale) >> 24) / times;
+  if (units > LONG_MAX) units = LONG_MAX;
+  return negative ? -(long)units : (long)units;
+}
+
+
+void BHX711::_updateMilliScale()
+{
+  _milliScale = (int64_t)(1000.0 * 16777216.0 * _scale);
+}
+
+
+///////////////////////////////////////////////////////
+//
+//  TARE
+//
+uint16_t BHX711::tare_converged(float tolerance, uint32_t timeout, uint8_t minTimes)
+{
+  HX711Stats stats;
+#if HX711_MAX_CHANNELS > 1
+  _extraReads = 0;
+#endif
+  uint16_t n = _measure(stats, 0, tolerance, timeout, minTimes);
+  _offset = (long)(stats.mean() + (stats.mean() < 0 ? -0.5 : 0.5));
+#if HX711_MAX_CHANNELS > 1
+  for (uint8_t i = 0; i < _extraCount; i++)
+  {
+    _extraOffset[i] = _extraAverage(i);
+  }
+  _extraReads = 0;
+#endif
+  _tareStdError = stats.std_error();
+  _stdError = _tareStdError;
+  return n;
+}
+
+
+void BHX711::tare(uint8_t times)
+{
+#if HX711_MAX_CHANNELS > 1
+  _extraReads = 0;
+#endif
+  _offset = read_average(times);
+#if HX711_MAX_CHANNELS > 1
+  for (uint8_t i = 0; i < _extraCount; i++)
+  {
+    _extraOffset[i] = _extraAverage(i);
+  }
+  _extraReads = 0;
+#endif
+}
+
+
+float BHX711::get_tare()
+{
+  return -_offset * _scale;
+}
+
+
+bool BHX711::tare_set()
+{
+  return _offset != 0;
+}
+
+
+///////////////////////////////////////////////////////
+//
+//  GAIN
+//
+//  note: if parameter gain == 0xFF40 some compilers
+//  will map that to 0x40 == HX711_CHANNEL_A_GAIN_64;
+//  solution: use uint32_t or larger parameters everywhere.
+//  note that changing gain/channel may take up to 400 ms (page 3)
+bool BHX711::set_gain(uint8_t gain, bool forced)
+{
+  if ( (not forced) && (_gain == gain)) return true;
+  switch(gain)
+  {
+    case HX711_CHANNEL_B_GAIN_32:
+    case HX711_CHANNEL_A_GAIN_64:
+    case HX711_CHANNEL_A_GAIN_128:
+      _gain = gain;
+      read();     //  next user read() is from right channel / gain
+      return true;
+  }
+  return false;   //  unchanged, but incorrect value.
+}
+
+
+uint8_t BHX711::get_gain()
+{
+  return _gain;
+}
+
+
+///////////////////////////////////////////////////////
+//
+//  CALIBRATION AND SETUP
+//
+bool BHX711::set_scale(float scale)
+{
+  if (scale == 0) return false;
+  _scale = 1.0 / scale;
+  _updateMilliScale();
+  return true;
+}
+
+
+float BHX711::get_scale()
+{
+  return 1.0 / _scale;
+}
+
+
+void BHX711::set_offset(long offset)
+{
+  _offset = offset;
+}
+
+
+long BHX711::get_offset()
+{
+  return _offset;
+}
+
+
+//  assumes tare() has been set.
+/*void HX711::calibrate_scale(uint16_t weight, uint8_t times)
+{
+  _scale = (1.0 * weight) / (read_average(times) - _offset);
+}
+*/
+void BHX711::calibrate_scale(float weight, uint8_t times)
+{
+  _scale = (1.0 * weight) / (read_average(times) - _offset);
+  _updateMilliScale();
+}
+
+
+uint16_t BHX711::calibrate_scale_converged(float weight, float tolerance, uint32_t timeout, uint8_t minTimes)
+{
+  HX711Stats stats;
+  uint16_t n = _measure(stats, 0, tolerance, timeout, minTimes);
+  _stdError = sqrt(stats.std_error() * stats.std_error() + _tareStdError * _tareStdError);
+  float diff = stats.mean() - _offset;
+  if (diff == 0) return n;
+  _scale = (1.0 * weight) / diff;
+  _updateMilliScale();
+  return n;
+}
+
+
+//  channel 0 is the main load cell, the others are the add_channel() ones
+uint16_t BHX711::_measure(HX711Stats &stats, uint8_t channel, float tolerance, uint32_t timeout, uint8_t minTimes)
+{
+  if (minTimes < 2) minTimes = 2;
+  stats.clear();
+  uint32_t start = millis();
+  while (true)
+  {
+    long value = read_long();
+#if HX711_MAX_CHANNELS > 1
+    if (channel > 0) value = _extraValue[channel - 1];
+#endif
+    stats.add(value);
+    yield();
+    if ((stats.count() >= minTimes) && (stats.std_error() <= tolerance)) break;
+    if (millis() - start >= timeout) break;
+    if (stats.count() == 0xFFFF) break;
+  }
+  return stats.count();
+}
+
+
+///////////////////////////////////////////////////////
+//
+//  POWER
+//
+void BHX711::power_down()
+{
+  //  at least 60 us HIGH
+  digitalWrite(_clockPin, HIGH);
+  delayMicroseconds(64);
+}
+
+
+void BHX711::power_up()
+{
+  digitalWrite(_clockPin, LOW);
+}
+
+
+///////////////////////////////////////////////////////
+//
+//  MISC
+//
+uint32_t BHX711::last_read()
+{
+  return _lastRead;
+}
+
+
+///////////////////////////////////////////////////////
+//
+//  INTERRUPT MODE
+//
+BHX711 * BHX711::_isrInstance = NULL;
+
+
+bool BHX711::start_interrupt_mode()
+{
+  if (_isrMode) return true;
+  int irq = digitalPinToInterrupt(_dataPin);
+  if (irq == NOT_AN_INTERRUPT) return false;
+#if HX711_MAX_CHANNELS > 1
+  for (uint8_t i = 0; i < _extraCount; i++)
+  {
+    if (digitalPinToInterrupt(_extraPins[i]) == NOT_AN_INTERRUPT) return false;
+  }
+#endif
+#if defined ESP32 || defined ARDUINO_ARCH_ESP32
+  //  digitalWrite() and delayMicroseconds() of the generic shifter
+  //  are in the flash, the interrupt has to use a FASTIO one.
+#if HX711_MAX_CHANNELS > 1
+  if (_extraCount > 0)
+  {
+    if (_fastReadAll == NULL) return false;
+  }
+  else
+#endif
+  if (_fastRead == NULL) return false;
+#endif
+
+  _samples.clear();
+  _samples.resetOverruns();
+  _timeouts = 0;
+  _isrInstance = this;
+  _isrMode = true;
+  attachInterrupt(irq, _dataReadyISR, FALLING);
+#if HX711_MAX_CHANNELS > 1
+  for (uint8_t i = 0; i < _extraCount; i++)
+  {
+    attachInterrupt(digitalPinToInterrupt(_extraPins[i]), _dataReadyISR, FALLING);
+  }
+#endif
+  //  a conversion that is already waiting will not give a new edge,
+  //  clock it out so that the next one does.
+  if (is_ready())
+  {
+    noInterrupts();
+    _readConversion();
+    interrupts();
+  }
+  return true;
+}
+
+
+void BHX711::stop_interrupt_mode()
+{
+  if (!_isrMode) return;
+  detachInterrupt(digitalPinToInterrupt(_dataPin));
+#if HX711_MAX_CHANNELS > 1
+  for (uint8_t i = 0; i < _extraCount; i++)
+  {
+    detachInterrupt(digitalPinToInterrupt(_extraPins[i]));
+  }
+#endif
+  _isrMode = false;
+  _isrInstance = NULL;
+}
+
+
+uint8_t BHX711::available()
+{
+  return _samples.available();
+}
+
+
+bool BHX711::read_sample(long &value, uint32_t &time)
+{
+  HX711Sample sample;
+  if (!_samples.pop(sample)) return false;
+  value = sample.value;
+  time  = sample.time;
+  _lastRead = sample.time;
+  return true;
+}
+
+
+uint16_t BHX711::get_overruns()
+{
+  return _samples.getOverruns();
+}
+
+
+//  data ready interrupt routine
+void HX711_ISR_ATTR BHX711::_dataReadyISR()
+{
+  BHX711 * hx = _isrInstance;
+  if (hx == NULL) return;
+  //  the data bits clocked out below also give falling edges on DOUT.
+  //  DOUT is HIGH again once the conversion has been read so these
+  //  pending interrupts are ignored here.
+  //  with several load cells the last one to be ready does the read.
+  if (!hx->is_ready()) return;
+
+  HX711Sample sample;
+  sample.value = hx->_readConversion();
+  sample.time  = HX711_ISR_MILLIS();
+#if HX711_MAX_CHANNELS > 1
+  for (uint8_t i = 0; i < hx->_extraCount; i++)
+  {
+    sample.extra[i] = hx->_extraValue[i];
+  }
+#endif
+  hx->_samples.push(sample);
+}
+
+
+/////////////////////////////////////////////////////////
+//
+//  PRIVATE
+//
+
+void BHX711::_insertSort(float * array, uint8_t size)
+{
+  uint8_t t, z;
+  float temp;
+  for (t = 1; t < size; t++)
+  {
+    z = t;
+    temp = array[z];
+    while( (z > 0) && (temp < array[z - 1] ))
+    {
+      array[z] = array[z - 1];
+      z--;
+    }
+    array[z] = temp;
+    yield();
+  }
+}
+
+
+//  drop the oldest value from the sorted window once it is full
+//  then insert the new one, at most 2 * 15 moves per conversion
+void BHX711::_windowPush(long value)
+{
+  uint8_t n = _windowCount;
+  if (n == _windowSize)
+  {
+    long oldest = _window[_windowOldest];
+    uint8_t i = 0;
+    while (_sorted[i] != oldest) i++;
+    for (n--; i < n; i++) _sorted[i] = _sorted[i + 1];
+    _window[_windowOldest] = value;
+    _windowOldest++;
+    if (_windowOldest == _windowSize) _windowOldest = 0;
+  }
+  else
+  {
+    _window[n] = value;
+  }
+
+  uint8_t z = n;
+  while ((z > 0) && (value < _sorted[z - 1]))
+  {
+    _sorted[z] = _sorted[z - 1];
+    z--;
+  }
+  _sorted[z] = value;
+  _windowCount = n + 1;
+}
+
+
+//  the integrator runs on every conversion, the comb keeps the
+//  integrator of "ratio" conversions ago. until the comb is full
+//  the output is scaled up from the conversions seen so far.
+void BHX711::_decimatePush(long value)
+{
+  _cicIntegrator += (uint32_t)value;
+  uint32_t delayed = _cicComb[_cicIndex];
+  _cicComb[_cicIndex] = _cicIntegrator;
+  _cicIndex++;
+  if (_cicIndex == _decimation) _cicIndex = 0;
+  if (_cicCount < _decimation) _cicCount++;
+
+  long sum = (long)(_cicIntegrator - delayed);
+  if (_cicCount < _decimation) sum = sum / _cicCount * _decimation;
+
+  if (_firTaps == 0)
+  {
+    _decimatedSum = sum;
+    return;
+  }
+  _firHistory[_firIndex] = sum;
+  if (_firCount < _firTaps) _firCount++;
+  if (_firCount < _firTaps)
+  {
+    _decimatedSum = sum;
+  }
+  else
+  {
+    //  _fir[0] goes with the newest sum
+    int64_t acc = 0;
+    uint8_t k = _firIndex;
+    for (uint8_t i = 0; i < _firTaps; i++)
+    {
+      acc += (int64_t)_fir[i] * _firHistory[k];
+      k = (k == 0) ? _firTaps - 1 : k - 1;
+    }
+    _decimatedSum = (long)(acc / 32768);
+  }
+  _firIndex++;
+  if (_firIndex == _firTaps) _firIndex = 0;
+}
+
+
+//  keep the Kalman filter of get_units_filtered() running
+void BHX711::_filterPush(long value)
+{
+#ifdef FIXED_POINT_THRUST
+  _last_average_filtered = _kalman.update(value * 16);
+#else
+  _last_average_read_value = _kalman.update(value);
+#endif
+}
+
+
+//  clock out one conversion, DOUT must be LOW
+//  the caller is responsible for disabling interrupts.
+long HX711_ISR_ATTR BHX711::_readConversion()
+{
+  //  TABLE 3 page 4 datasheet
+  //
+  //  CLOCK      CHANNEL      GAIN      m
+  //  ------------------------------------
+  //   25           A         128       1    //  default
+  //   26           B          32       2
+  //   27           A          64       3
+  //
+  //  only default 128 verified,
+  //  selection goes through the set_gain(gain)
+  //
+  uint8_t m = 1;
+  if      (_gain == HX711_CHANNEL_A_GAIN_128) m = 1;
+  else if (_gain == HX711_CHANNEL_A_GAIN_64)  m = 3;
+  else if (_gain == HX711_CHANNEL_B_GAIN_32)  m = 2;
+
+#if HX711_MAX_CHANNELS > 1
+  if (_extraCount > 0) return _readBurst(m);
+#endif
+
+  //  pin specialised shifter, see begin<FASTIO>()
+  if (_fastRead != NULL) return _fastRead(m);
+
+  union
+  {
+    long value = 0;
+    uint8_t data[4];
+  } v;
+
+  //  Pulse the clock pin 24 times to read the data.
+  //  v.data[2] = shiftIn(_dataPin, _clockPin, MSBFIRST);
+  //  v.data[1] = shiftIn(_dataPin, _clockPin, MSBFIRST);
+  //  v.data[0] = shiftIn(_dataPin, _clockPin, MSBFIRST);
+  v.data[2] = _shiftIn();
+  v.data[1] = _shiftIn();
+  v.data[0] = _shiftIn();
+
+  while (m > 0)
+  {
+    //  delayMicroSeconds(1) needed for fast processors?
+    digitalWrite(_clockPin, HIGH);
+    digitalWrite(_clockPin, LOW);
+    m--;
+  }
+
+  //  SIGN extend
+  if (v.data[2] & 0x80) v.data[3] = 0xFF;
+
+  return v.value;
+}
+
+
+#if HX711_MAX_CHANNELS > 1
+//  all the DOUT pins are sampled on the same clock pulses
+long HX711_ISR_ATTR BHX711::_readBurst(uint8_t pulses)
+{
+  long values[HX711_MAX_CHANNELS];
+  uint8_t n = _extraCount + 1;
+  if (_fastReadAll != NULL)
+  {
+    _fastReadAll(pulses, values);
+  }
+  else
+  {
+    for (uint8_t c = 0; c < n; c++) values[c] = 0;
+    for (uint8_t bit = 0; bit < 24; bit++)
+    {
+      digitalWrite(_clockPin, HIGH);
+      delayMicroseconds(1);   //  T2  >= 0.2 us
+      values[0] = (values[0] << 1) | (digitalRead(_dataPin) == HIGH);
+      for (uint8_t c = 1; c < n; c++)
+      {
+        values[c] = (values[c] << 1) | (digitalRead(_extraPins[c - 1]) == HIGH);
+      }
+      digitalWrite(_clockPin, LOW);
+      delayMicroseconds(1);
+    }
+    while (pulses > 0)
+    {
+      digitalWrite(_clockPin, HIGH);
+      digitalWrite(_clockPin, LOW);
+      pulses--;
+    }
+    //  SIGN extend
+    for (uint8_t c = 0; c < n; c++)
+    {
+      if (values[c] & 0x800000) values[c] -= 0x1000000L;
+    }
+  }
+  for (uint8_t c = 1; c < n; c++) _extraValue[c - 1] = values[c];
+  return values[0];
+}
+
+
+bool BHX711::add_channel(uint8_t dataPin)
+{
+  if (_extraCount >= HX711_MAX_CHANNELS - 1) return false;
+  pinMode(dataPin, INPUT);
+  _extraPins[_extraCount]       = dataPin;
+  _extraOffset[_extraCount]     = 0;
+  _extraScale[_extraCount]      = 1;
+  _extraMilliScale[_extraCount] = (int64_t)(1000.0 * 16777216.0);
+  _extraCount++;
+  _extraReads = 0;
+  return true;
+}
+
+
+uint8_t BHX711::get_milli_units_channels(long * values)
+{
+  for (uint8_t i = 0; i < _extraCount; i++)
+  {
+    if (_extraReads == 0)
+      values[i] = _toMilliUnits(_extraValue[i] - _extraOffset[i], 1, _extraMilliScale[i]);
+    else
+      values[i] = _toMilliUnits(_extraSum[i] - (long)_extraReads * _extraOffset[i], _extraReads, _extraMilliScale[i]);
+  }
+  _extraReads = 0;
+  return _extraCount;
+}
+
+
+void BHX711::set_offset_channel(uint8_t channel, long offset)
+{
+  if (channel < 1 || channel > _extraCount) return;
+  _extraOffset[channel - 1] = offset;
+}
+
+
+long BHX711::get_offset_channel(uint8_t channel)
+{
+  if (channel < 1 || channel > _extraCount) return 0;
+  return _extraOffset[channel - 1];
+}
+
+
+bool BHX711::set_scale_channel(uint8_t channel, float scale)
+{
+  if (channel < 1 || channel > _extraCount) return false;
+  if (scale == 0) return false;
+  _extraScale[channel - 1] = 1.0 / scale;
+  _extraMilliScale[channel - 1] = (int64_t)(1000.0 * 16777216.0 / scale);
+  return true;
+}
+
+
+float BHX711::get_scale_channel(uint8_t channel)
+{
+  if (channel < 1 || channel > _extraCount) return 0;
+  return 1.0 / _extraScale[channel - 1];
+}
+
+
+uint16_t BHX711::calibrate_scale_channel(uint8_t channel, float weight, float tolerance, uint32_t timeout, uint8_t minTimes)
+{
+  if (channel < 1 || channel > _extraCount) return 0;
+  HX711Stats stats;
+  uint16_t n = _measure(stats, channel, tolerance, timeout, minTimes);
+  _extraReads = 0;
+  _stdError = stats.std_error();
+  float diff = stats.mean() - _extraOffset[channel - 1];
+  if (diff == 0) return n;
+  set_scale_channel(channel, diff / weight);
+  return n;
+}
+
+
+void BHX711::_extraAccumulate(const long * values)
+{
+  if (_extraReads == 0 || _extraReads == 255)
+  {
+    for (uint8_t i = 0; i < _extraCount; i++) _extraSum[i] = 0;
+    _extraReads = 0;
+  }
+  for (uint8_t i = 0; i < _extraCount; i++) _extraSum[i] += values[i];
+  _extraReads++;
+}
+
+
+//  last burst if nothing was read since the sums were cleared
+long BHX711::_extraAverage(uint8_t index)
+{
+  if (_extraReads == 0) return _extraValue[index];
+  return _extraSum[index] / _extraReads;
+}
+#endif
+
+
+//  MSB_FIRST optimized shiftIn
+//  see datasheet page 5 for timing
+uint8_t BHX711::_shiftIn()
+{
+  //  local variables are faster.
+  uint8_t clk   = _clockPin;
+  uint8_t data  = _dataPin;
+  uint8_t value = 0;
+  uint8_t mask  = 0x80;
+  while (mask > 0)
+  {
+    digitalWrite(clk, HIGH);
+    delayMicroseconds(1);   //  T2  >= 0.2 us
+    if (digitalRead(data) == HIGH)
+    {
+      value |= mask;
+    }
+    digitalWrite(clk, LOW);
+    delayMicroseconds(1);   //  keep duty cycle ~50%
+    mask >>= 1;
+  }
+  return value;
+}
+
+
+//  -- END OF FILE --
@@ -1,175 +1,422 @@
-#pragma once
-//
-//    FILE: HX711.h
-//  AUTHOR: Rob Tillaart
-// VERSION: 0.3.9
-// PURPOSE: Library for load cells for Arduino
-//     URL: https://github.com/RobTillaart/HX711
-//
-//  NOTES
-//  Superset of interface of HX711 class of Bogde
-//  float instead of long as float has 23 bits mantissa.
-
-
-#include "Arduino.h"
-
-#define HX711_LIB_VERSION               (F("0.3.9"))
-
-
-const uint8_t HX711_AVERAGE_MODE = 0x00;
-//  in median mode only between 3 and 15 samples are allowed.
-const uint8_t HX711_MEDIAN_MODE  = 0x01;
-//  medavg = average of the middle "half" of sorted elements
-//  in medavg mode only between 3 and 15 samples are allowed.
-const uint8_t HX711_MEDAVG_MODE  = 0x02;
-//  runavg = running average
-const uint8_t HX711_RUNAVG_MODE  = 0x03;
-//  causes read() to be called only once!
-const uint8_t HX711_RAW_MODE     = 0x04;
-
-
-//  supported values for set_gain()
-const uint8_t HX711_CHANNEL_A_GAIN_128 = 128;  //  default
-const uint8_t HX711_CHANNEL_A_GAIN_64 = 64;
-const uint8_t HX711_CHANNEL_B_GAIN_32 = 32;
-
-
-class BHX711
-{
-public:
-  BHX711();
-  ~BHX711();
-
-  //  fixed gain 128 for now
-  void     begin(uint8_t dataPin, uint8_t clockPin);
-
-  void     reset();
-
-  //  checks if load cell is ready to read.
-  bool     is_ready();
-
-  //  wait until ready,
-  //  check every ms
-  void     wait_ready(uint32_t ms = 0);
-  //  max # retries
-  bool     wait_ready_retry(uint8_t retries = 3, uint32_t ms = 0);
-  //  max timeout
-  bool     wait_ready_timeout(uint32_t timeout = 1000, uint32_t ms = 0);
-
-  //  raw read
-  float    read();
-  float    kalman_read();
-
-  //  get average of multiple raw reads
-  //  times = 1 or more
-  float    read_average(uint8_t times = 10);
-
-  //  get median of multiple raw reads
-  //  times = 3..15 - odd numbers preferred
-  float    read_median(uint8_t times = 7);
-
-  //  get average of "middle half" of multiple raw reads.
-  //  times = 3..15 - odd numbers preferred
-  float    read_medavg(uint8_t times = 7);
-
-  //  get running average over times measurements.
-  //  the weight alpha can be set to any value between 0 and 1
-  //  times = 1 or more.
-  float    read_runavg(uint8_t times = 7, float alpha = 0.5);
-
-
-  //  get set mode for get_value() and indirect get_units().
-  //  in median and medavg mode only 3..15 samples are allowed.
-  void     set_raw_mode();
-  void     set_average_mode();
-  void     set_median_mode();
-  void     set_medavg_mode();
-  //  set_run_avg will use a default alpha of 0.5.
-  void     set_runavg_mode();
-  uint8_t  get_mode();
-
-  //  corrected for offset.
-  //  in HX711_RAW_MODE the parameter times will be ignored.
-  float    get_value(uint8_t times = 1);
-  //  converted to proper units, corrected for scale.
-  //  in HX711_RAW_MODE the parameter times will be ignored.
-  float    get_units(uint8_t times = 1);
-  float get_units_filtered();
-
-
-  //  TARE
-  //  call tare to calibrate zero
-  void     tare(uint8_t times = 10);
-  float    get_tare();
-  bool     tare_set();
-
-
-  //  CORE "CONSTANTS" -> read datasheet
-  //  CHANNEL      GAIN   notes
-  //  -------------------------------------
-  //     A         128    default, tested
-  //     A          64
-  //     B          32
-
-  //  returns true  ==>  parameter gain is valid
-  //  returns false ==>  parameter gain is invalid ==> no change.
-  //  note that changing gain/channel takes up to 400 ms (page 3)
-  //  if forced == true, the gain will be forced set
-  //  even it is already the right value
-  bool     set_gain(uint8_t gain = HX711_CHANNEL_A_GAIN_128, bool forced = false);
-  uint8_t  get_gain();
-
-
-  //  CALIBRATION & SETUP
-  //  SCALE > 0
-  //  returns false if scale == 0;
-  bool     set_scale(float scale = 1.0);
-  float    get_scale();
-
-  //  OFFSET > 0
-  void     set_offset(long offset = 0);
-  long     get_offset();
-
-  //  clear the scale
-  //  call tare() to set the zero offset
-  //  put a known weight on the scale
-  //  call calibrate_scale(weight)
-  //  scale is calculated.
-  //void     calibrate_scale(uint16_t weight, uint8_t times = 10);
-  void     calibrate_scale(float weight, uint8_t times = 10);
-
-
-  //  POWER MANAGEMENT
-  void     power_down();
-  void     power_up();
-
-
-  //  TIME OF LAST READ
-  uint32_t last_read();
-
-
-  //  PRICING
-  float    get_price(uint8_t times = 1) { return get_units(times) * _price; };
-  void     set_unit_price(float price = 1.0) { _price = price; };
-  float    get_unit_price() { return _price; };
-
-
-private:
-  uint8_t  _dataPin;
-  uint8_t  _clockPin;
-
-  uint8_t  _gain     = 128;     //  default channel A
-  long     _offset   = 0;
-  float    _scale    = 1;
-  uint32_t _lastRead = 0;
-  float    _price    = 0;
-  uint8_t  _mode     = 0;
-  float    _last_read_value = 0;
-  float    _last_average_read_value = 0;
-  void     _insertSort(float * array, uint8_t size);
-  uint8_t  _shiftIn();
-  
-};
-
-
-//  -- END OF FILE --
+#pragma once
+//
+//    FILE: HX711.h
+//  AUTHOR: Rob Tillaart
+// VERSION: 0.3.9
+// PURPOSE: Library for load cells for Arduino
+//     URL: https://github.com/RobTillaart/HX711
+//
+//  NOTES
+//  Superset of interface of HX711 class of Bogde
+//  float instead of long as float has 23 bits mantissa.
+
+
+#include "Arduino.h"
+#include "config.h"
+#include "ringbuffer.h"
+#include "kalman.h"
+
+#define HX711_LIB_VERSION               (F("0.3.9"))
+
+
+const uint8_t HX711_AVERAGE_MODE = 0x00;
+//  in median mode only between 3 and 15 samples are allowed.
+const uint8_t HX711_MEDIAN_MODE  = 0x01;
+//  medavg = average of the middle "half" of sorted elements
+//  in medavg mode only between 3 and 15 samples are allowed.
+const uint8_t HX711_MEDAVG_MODE  = 0x02;
+//  runavg = running average
+const uint8_t HX711_RUNAVG_MODE  = 0x03;
+//  causes read() to be called only once!
+const uint8_t HX711_RAW_MODE     = 0x04;
+//  streaming median / medavg over a sliding window of the last
+//  3..15 conversions, times is the number of new conversions.
+const uint8_t HX711_STREAM_MEDIAN_MODE = 0x05;
+const uint8_t HX711_STREAM_MEDAVG_MODE = 0x06;
+
+#define HX711_WINDOW_MAX 15
+//  decimate = boxcar (CIC of order 1) over the last "ratio"
+//  conversions followed by an optional short FIR, times is the
+//  number of new conversions, ratio 1 is a pass through.
+const uint8_t HX711_DECIMATE_MODE = 0x07;
+
+#define HX711_DECIMATE_MAX 16
+#define HX711_FIR_MAX 8
+
+
+//  supported values for set_gain()
+const uint8_t HX711_CHANNEL_A_GAIN_128 = 128;  //  default
+const uint8_t HX711_CHANNEL_A_GAIN_64 = 64;
+const uint8_t HX711_CHANNEL_B_GAIN_32 = 32;
+
+
+//  conversions queued by the data ready interrupt
+//  at 80 SPS 16 samples is 200 ms of backlog
+#ifdef __AVR__
+#define HX711_SAMPLE_BUFFER_SIZE 16
+#else
+#define HX711_SAMPLE_BUFFER_SIZE 64
+#endif
+
+//  the ESP32 may run the interrupt while the flash is being written
+//  with the caches off, all of its path is kept in IRAM then and the
+//  time comes from esp_timer_get_time() which is in IRAM too.
+#if defined ESP32 || defined ARDUINO_ARCH_ESP32
+#include "esp_timer.h"
+#define HX711_ISR_ATTR IRAM_ATTR
+#define HX711_ISR_MILLIS() ((uint32_t)(esp_timer_get_time() / 1000))
+#else
+#define HX711_ISR_ATTR
+#define HX711_ISR_MILLIS() millis()
+#endif
+
+//  read() gives up after one conversion at 10 SPS and a margin,
+//  an unplugged HX711 never pulls DOUT low
+#define HX711_READ_TIMEOUT 150
+
+//  load cells sharing the clock line, see add_channel()
+#if defined NBR_LOADCELLS && NBR_LOADCELLS > 1
+#define HX711_MAX_CHANNELS NBR_LOADCELLS
+#else
+#define HX711_MAX_CHANNELS 1
+#endif
+
+struct HX711Sample {
+  long     value;
+  uint32_t time;
+#if HX711_MAX_CHANNELS > 1
+  long     extra[HX711_MAX_CHANNELS - 1];
+#endif
+};
+
+
+//  online mean and variance (Welford), no need to keep the values
+class HX711Stats
+{
+public:
+  void     clear() { _count = 0; _mean = 0; _m2 = 0; };
+  void     add(float value)
+  {
+    _count++;
+    float delta = value - _mean;
+    _mean += delta / _count;
+    _m2   += delta * (value - _mean);
+  };
+  uint16_t count()    { return _count; };
+  float    mean()     { return _mean; };
+  //  sample variance, 0 below 2 values
+  float    variance() { return _count < 2 ? 0 : _m2 / (_count - 1); };
+  //  standard error of the mean
+  float    std_error() { return _count < 2 ? 0 : sqrt(variance() / _count); };
+
+private:
+  uint16_t _count = 0;
+  float    _mean  = 0;
+  float    _m2    = 0;
+};
+
+
+class BHX711
+{
+public:
+  BHX711();
+  ~BHX711();
+
+  //  fixed gain 128 for now
+  void     begin(uint8_t dataPin, uint8_t clockPin);
+  //  same with the conversions clocked out by a pin specialised
+  //  shifter, ie begin< BHX711FastIO<DOUT, SCK> >(dataPin, clockPin)
+  //  see BHX711FastIO.h
+  template <class FASTIO>
+  void     begin(uint8_t dataPin, uint8_t clockPin)
+  {
+    _fastRead = FASTIO::readConversion;
+    begin(dataPin, clockPin);
+  };
+
+#if HX711_MAX_CHANNELS > 1
+  //  extra load cells on the same clock line, numbered 1, 2, ...
+  //  they are all clocked out in the same burst as the first one.
+  //  call before begin().
+  bool     add_channel(uint8_t dataPin);
+  uint8_t  get_channels() { return _extraCount + 1; };
+
+  //  BURSTIO reads all the DOUT pins, see BHX711MultiFastIO
+  template <class BURSTIO>
+  void     begin_burst(uint8_t dataPin, uint8_t clockPin)
+  {
+    _fastReadAll = BURSTIO::readConversions;
+    begin(dataPin, clockPin);
+  };
+
+  //  average of each extra channel over the conversions read since
+  //  the last call, units * 1000, corrected for offset and scale.
+  //  values[0] is channel 1, returns the number of extra channels.
+  uint8_t  get_milli_units_channels(long * values);
+  void     set_offset_channel(uint8_t channel, long offset);
+  long     get_offset_channel(uint8_t channel);
+  bool     set_scale_channel(uint8_t channel, float scale);
+  float    get_scale_channel(uint8_t channel);
+  //  tare() has to be done first, same early stop as
+  //  calibrate_scale_converged()
+  uint16_t calibrate_scale_channel(uint8_t channel, float weight, float tolerance, uint32_t timeout, uint8_t minTimes = 5);
+#endif
+
+  void     reset();
+
+  //  checks if load cell is ready to read.
+  bool     HX711_ISR_ATTR is_ready();
+
+  //  wait until ready,
+  //  check every ms
+  void     wait_ready(uint32_t ms = 0);
+  //  max # retries
+  bool     wait_ready_retry(uint8_t retries = 3, uint32_t ms = 0);
+  //  max timeout
+  bool     wait_ready_timeout(uint32_t timeout = 1000, uint32_t ms = 0);
+
+  //  raw read
+  //  after HX711_READ_TIMEOUT ms without a conversion the last value is
+  //  returned again and get_timeouts() counts it
+  float    read();
+  long     read_long();
+  float    kalman_read();
+
+  //  get average of multiple raw reads
+  //  times = 1 or more
+  float    read_average(uint8_t times = 10);
+
+  //  get median of multiple raw reads
+  //  times = 3..15 - odd numbers preferred
+  float    read_median(uint8_t times = 7);
+
+  //  get average of "middle half" of multiple raw reads.
+  //  times = 3..15 - odd numbers preferred
+  float    read_medavg(uint8_t times = 7);
+
+  //  get running average over times measurements.
+  //  the weight alpha can be set to any value between 0 and 1
+  //  times = 1 or more.
+  float    read_runavg(uint8_t times = 7, float alpha = 0.5);
+
+  //  feed times new conversions to the sliding window then
+  //  get the median or the average of its "middle half".
+  //  one output per conversion instead of one per window.
+  float    read_stream_median(uint8_t times = 1);
+  float    read_stream_medavg(uint8_t times = 1);
+  //  window = 3..15, clears the window
+  void     set_window(uint8_t window);
+  uint8_t  get_window() { return _windowSize; };
+  void     clear_window();
+
+  //  feed times new conversions to the decimator then get
+  //  its latest output.
+  float    read_decimated(uint8_t times = 1);
+  //  ratio = 1..16, clears the decimator
+  void     set_decimation(uint8_t ratio);
+  uint8_t  get_decimation() { return _decimation; };
+  //  taps = 0..8 coefficients in 1/32768, they should add up to
+  //  32768. the array is not copied. taps = 0 removes the FIR.
+  void     set_fir(const int16_t * coefficients, uint8_t taps);
+  void     clear_decimation();
+
+
+  //  get set mode for get_value() and indirect get_units().
+  //  in median and medavg mode only 3..15 samples are allowed.
+  void     set_raw_mode();
+  void     set_average_mode();
+  void     set_median_mode();
+  void     set_medavg_mode();
+  //  set_run_avg will use a default alpha of 0.5.
+  void     set_runavg_mode();
+  void     set_stream_median_mode(uint8_t window = 7);
+  void     set_stream_medavg_mode(uint8_t window = 7);
+  void     set_decimate_mode(uint8_t ratio = 4);
+  uint8_t  get_mode();
+
+  //  corrected for offset.
+  //  in HX711_RAW_MODE the parameter times will be ignored.
+  float    get_value(uint8_t times = 1);
+  //  converted to proper units, corrected for scale.
+  //  in HX711_RAW_MODE the parameter times will be ignored.
+  float    get_units(uint8_t times = 1);
+  float get_units_filtered();
+  //  integer versions, units * 1000, corrected for offset and scale.
+  //  always averages, the other modes go through get_units().
+  long     get_milli_units(uint8_t times = 1);
+  long     get_milli_units_filtered();
+
+
+  //  TARE
+  //  call tare to calibrate zero
+  void     tare(uint8_t times = 10);
+  //  read until the standard error of the mean is below tolerance
+  //  (in raw counts) or timeout ms have passed, minTimes reads at
+  //  least. returns the number of reads. not in interrupt mode.
+  uint16_t tare_converged(float tolerance, uint32_t timeout, uint8_t minTimes = 5);
+  float    get_tare();
+  bool     tare_set();
+
+
+  //  CORE "CONSTANTS" -> read datasheet
+  //  CHANNEL      GAIN   notes
+  //  -------------------------------------
+  //     A         128    default, tested
+  //     A          64
+  //     B          32
+
+  //  returns true  ==>  parameter gain is valid
+  //  returns false ==>  parameter gain is invalid ==> no change.
+  //  note that changing gain/channel takes up to 400 ms (page 3)
+  //  if forced == true, the gain will be forced set
+  //  even it is already the right value
+  bool     set_gain(uint8_t gain = HX711_CHANNEL_A_GAIN_128, bool forced = false);
+  uint8_t  get_gain();
+
+
+  //  CALIBRATION & SETUP
+  //  SCALE > 0
+  //  returns false if scale == 0;
+  bool     set_scale(float scale = 1.0);
+  float    get_scale();
+
+  //  OFFSET > 0
+  void     set_offset(long offset = 0);
+  long     get_offset();
+
+  //  clear the scale
+  //  call tare() to set the zero offset
+  //  put a known weight on the scale
+  //  call calibrate_scale(weight)
+  //  scale is calculated.
+  //void     calibrate_scale(uint16_t weight, uint8_t times = 10);
+  void     calibrate_scale(float weight, uint8_t times = 10);
+  //  same early stop as tare_converged()
+  uint16_t calibrate_scale_converged(float weight, float tolerance, uint32_t timeout, uint8_t minTimes = 5);
+  //  standard error in raw counts of the last converged tare or
+  //  calibration, the calibration one includes the tare one.
+  float    get_std_error() { return _stdError; };
+
+
+  //  POWER MANAGEMENT
+  void     power_down();
+  void     power_up();
+
+
+  //  TIME OF LAST READ
+  //  in interrupt mode this is the time the conversion was clocked out
+  uint32_t last_read();
+
+
+  //  INTERRUPT DRIVEN ACQUISITION
+  //  the DOUT falling edge raises an interrupt, the conversion is clocked
+  //  out in the interrupt routine and queued with its timestamp.
+  //  read() then takes the conversions from the queue so none are lost
+  //  while the caller is busy.
+  //  returns false if the data pin has no interrupt, or on the ESP32
+  //  if there is no FASTIO shifter, see begin<FASTIO>().
+  //  only one BHX711 can be in interrupt mode at a time.
+  bool     start_interrupt_mode();
+  void     stop_interrupt_mode();
+  bool     is_interrupt_mode() { return _isrMode; };
+  //  number of queued conversions
+  uint8_t  available();
+  //  non blocking, returns false if nothing is queued
+  bool     read_sample(long &value, uint32_t &time);
+  //  conversions dropped because the queue was full
+  uint16_t get_overruns();
+  //  reads that timed out, reset by start_interrupt_mode()
+  uint16_t get_timeouts() { return _timeouts; };
+
+
+  //  PRICING
+  float    get_price(uint8_t times = 1) { return get_units(times) * _price; };
+  void     set_unit_price(float price = 1.0) { _price = price; };
+  float    get_unit_price() { return _price; };
+
+
+private:
+  uint8_t  _dataPin;
+  uint8_t  _clockPin;
+
+  uint8_t  _gain     = 128;     //  default channel A
+  long     _offset   = 0;
+  float    _scale    = 1;
+  uint32_t _lastRead = 0;
+  float    _price    = 0;
+  uint8_t  _mode     = 0;
+  float    _last_read_value = 0;
+  long     _lastValue = 0;
+  uint16_t _timeouts = 0;
+  long     _readTimeout();
+  float    _last_average_read_value = 0;
+  //  1000 / scale in 1/2^24
+  int64_t  _milliScale = 0;
+#ifdef FIXED_POINT_THRUST
+  KalmanFilterFixed _kalman;
+  //  in 1/16 of a count
+  long     _last_average_filtered = 0;
+#else
+  KalmanFilter _kalman;
+#endif
+  void     _updateMilliScale();
+  float    _stdError = 0;
+  float    _tareStdError = 0;
+  uint16_t _measure(HX711Stats &stats, uint8_t channel, float tolerance, uint32_t timeout, uint8_t minTimes);
+  long     _toMilliUnits(long diffSum, uint8_t times);
+  long     _toMilliUnits(long diffSum, uint8_t times, int64_t milliScale);
+  void     _insertSort(float * array, uint8_t size);
+
+  //  sliding window, _window in arrival order, _sorted ascending
+  long     _window[HX711_WINDOW_MAX];
+  long     _sorted[HX711_WINDOW_MAX];
+  uint8_t  _windowSize  = 7;
+  uint8_t  _windowCount = 0;
+  uint8_t  _windowOldest = 0;
+  void     _windowPush(long value);
+
+  //  decimator, integrator and comb of a first order CIC.
+  //  unsigned so that the integrator wraps around safely.
+  uint8_t  _decimation = 1;
+  uint32_t _cicIntegrator = 0;
+  uint32_t _cicComb[HX711_DECIMATE_MAX];
+  uint8_t  _cicIndex = 0;
+  uint8_t  _cicCount = 0;
+  const int16_t * _fir = NULL;
+  uint8_t  _firTaps = 0;
+  long     _firHistory[HX711_FIR_MAX];
+  uint8_t  _firIndex = 0;
+  uint8_t  _firCount = 0;
+  //  latest output = _decimatedSum / _decimation
+  long     _decimatedSum = 0;
+  void     _decimatePush(long value);
+  void     _filterPush(long value);
+  uint8_t  _shiftIn();
+  long     HX711_ISR_ATTR _readConversion();
+  long     (*_fastRead)(uint8_t pulses) = NULL;
+
+#if HX711_MAX_CHANNELS > 1
+  void     (*_fastReadAll)(uint8_t pulses, long * values) = NULL;
+  uint8_t  _extraPins[HX711_MAX_CHANNELS - 1];
+  uint8_t  _extraCount = 0;
+  //  last burst, filled by _readConversion()
+  long     _extraValue[HX711_MAX_CHANNELS - 1];
+  long     _extraSum[HX711_MAX_CHANNELS - 1];
+  uint8_t  _extraReads = 0;
+  long     _extraOffset[HX711_MAX_CHANNELS - 1];
+  float    _extraScale[HX711_MAX_CHANNELS - 1];
+  int64_t  _extraMilliScale[HX711_MAX_CHANNELS - 1];
+  long     HX711_ISR_ATTR _readBurst(uint8_t pulses);
+  void     _extraAccumulate(const long * values);
+  long     _extraAverage(uint8_t index);
+#endif
+
+  volatile bool _isrMode = false;
+  RingBuffer<HX711Sample, HX711_SAMPLE_BUFFER_SIZE> _samples;
+  static BHX711 * _isrInstance;
+  static void HX711_ISR_ATTR _dataReadyISR();
+
+};
+
+
+//  -- END OF FILE --
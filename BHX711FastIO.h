@@ -0,0 +1,232 @@
+#pragma once
+//
+//    FILE: BHX711FastIO.h
+// PURPOSE: compile time pin specialised shifter for BHX711
+//
+//  NOTES
+//  digitalWrite()/digitalRead() look up the port and bit of a pin on every
+//  call. With the pins fixed at compile time the clock and data lines are
+//  driven straight from the port registers, which keeps the time spent
+//  with interrupts disabled in BHX711::read() to a few tens of us.
+//
+//  template parameters
+//  AVR   : Arduino pin numbers (Uno pinout, D0-D7 PORTD, D8-D13 PORTB, A0-A5 PORTC)
+//  STM32 : pin names, ie PB_15
+//  ESP32 : GPIO numbers below 32
+//  other : Arduino pin numbers, falls back on digitalWrite()/digitalRead()
+
+
+#include "Arduino.h"
+#if defined(ESP32) || defined(ARDUINO_ARCH_ESP32)
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+//  the data ready interrupt clocks the conversions out with these, it
+//  also runs while the flash is busy so none of it may be in the flash
+#define HX711_FASTIO_ATTR IRAM_ATTR
+#define HX711_FASTIO_INLINE inline __attribute__((always_inline))
+#else
+#define HX711_FASTIO_ATTR
+#define HX711_FASTIO_INLINE inline
+#endif
+
+
+template <uint32_t DOUT, uint32_t SCK>
+class BHX711FastIO
+{
+public:
+  //  clock out one conversion then give "pulses" extra clocks
+  //  to select the gain of the next one. DOUT must be LOW.
+  //  the caller is responsible for disabling interrupts.
+  static long HX711_FASTIO_ATTR readConversion(uint8_t pulses)
+  {
+    union
+    {
+      long value = 0;
+      uint8_t data[4];
+    } v;
+
+    v.data[2] = shiftIn();
+    v.data[1] = shiftIn();
+    v.data[0] = shiftIn();
+
+    while (pulses > 0)
+    {
+      clockHigh();
+      hold();
+      clockLow();
+      hold();
+      pulses--;
+    }
+
+    //  SIGN extend
+    if (v.data[2] & 0x80) v.data[3] = 0xFF;
+    return v.value;
+  }
+
+  //  MSB first, see datasheet page 5 for timing
+  //  T2 (DOUT valid after SCK rising) <= 0.1 us
+  //  T3 and T4 (SCK high and low)     >= 0.2 us
+  static HX711_FASTIO_INLINE uint8_t shiftIn()
+  {
+    uint8_t value = 0;
+    for (uint8_t mask = 0x80; mask > 0; mask >>= 1)
+    {
+      clockHigh();
+      hold();
+      if (dataHigh()) value |= mask;
+      clockLow();
+      hold();
+    }
+    return value;
+  }
+
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)
+  static HX711_FASTIO_INLINE void clockHigh()
+  {
+    if (SCK < 8)       PORTD |= _BV(SCK);
+    else if (SCK < 14) PORTB |= _BV(SCK - 8);
+    else               PORTC |= _BV(SCK - 14);
+  }
+
+  static HX711_FASTIO_INLINE void clockLow()
+  {
+    if (SCK < 8)       PORTD &= ~_BV(SCK);
+    else if (SCK < 14) PORTB &= ~_BV(SCK - 8);
+    else               PORTC &= ~_BV(SCK - 14);
+  }
+
+  static HX711_FASTIO_INLINE bool dataHigh()
+  {
+    if (DOUT < 8)       return PIND & _BV(DOUT);
+    else if (DOUT < 14) return PINB & _BV(DOUT - 8);
+    else                return PINC & _BV(DOUT - 14);
+  }
+
+  //  2 cycles, with sbi/cbi this gives > 0.2 us at 16 MHz
+  static HX711_FASTIO_INLINE void hold()
+  {
+    __asm__ __volatile__("nop\n\tnop\n\t");
+  }
+
+#elif defined(ARDUINO_ARCH_STM32)
+  static HX711_FASTIO_INLINE GPIO_TypeDef * port(uint32_t pin)
+  {
+    return (GPIO_TypeDef *)(GPIOA_BASE + (GPIOB_BASE - GPIOA_BASE) * STM_PORT(pin));
+  }
+
+  static HX711_FASTIO_INLINE void clockHigh()
+  {
+    port(SCK)->BSRR = (1UL << STM_PIN(SCK));
+  }
+
+  static HX711_FASTIO_INLINE void clockLow()
+  {
+    port(SCK)->BSRR = (1UL << (STM_PIN(SCK) + 16));
+  }
+
+  static HX711_FASTIO_INLINE bool dataHigh()
+  {
+    return port(DOUT)->IDR & (1UL << STM_PIN(DOUT));
+  }
+
+  //  about 6 cycles per turn, > 0.2 us at 72 or 240 MHz
+  static HX711_FASTIO_INLINE void hold()
+  {
+    for (volatile uint8_t i = 0; i <= (F_CPU / 24000000UL); i++);
+  }
+
+#elif defined(ESP32) || defined(ARDUINO_ARCH_ESP32)
+  static_assert(DOUT < 32 && SCK < 32, "BHX711FastIO only handles GPIO 0 to 31");
+
+  static HX711_FASTIO_INLINE void clockHigh()
+  {
+    REG_WRITE(GPIO_OUT_W1TS_REG, 1UL << SCK);
+  }
+
+  static HX711_FASTIO_INLINE void clockLow()
+  {
+    REG_WRITE(GPIO_OUT_W1TC_REG, 1UL << SCK);
+  }
+
+  static HX711_FASTIO_INLINE bool dataHigh()
+  {
+    return (REG_READ(GPIO_IN_REG) >> DOUT) & 0x01;
+  }
+
+  static HX711_FASTIO_INLINE void hold()
+  {
+    for (volatile uint8_t i = 0; i <= (F_CPU / 24000000UL); i++);
+  }
+
+#else
+  //  unknown board, same as the generic BHX711 path
+  static HX711_FASTIO_INLINE void clockHigh()
+  {
+    digitalWrite(SCK, HIGH);
+  }
+
+  static HX711_FASTIO_INLINE void clockLow()
+  {
+    digitalWrite(SCK, LOW);
+  }
+
+  static HX711_FASTIO_INLINE bool dataHigh()
+  {
+    return digitalRead(DOUT) == HIGH;
+  }
+
+  static HX711_FASTIO_INLINE void hold()
+  {
+    delayMicroseconds(1);
+  }
+#endif
+};
+
+
+//  several load cells on one clock line, DOUT of channel 0 first.
+//  the same clock pulse shifts one bit out of every HX711.
+template <uint32_t SCK, uint32_t... DOUT>
+class BHX711MultiFastIO
+{
+public:
+  static const uint8_t channels = sizeof...(DOUT);
+
+  //  all DOUT must be LOW, the caller is responsible for
+  //  disabling interrupts.
+  static void HX711_FASTIO_ATTR readConversions(uint8_t pulses, long * values)
+  {
+    typedef BHX711FastIO<0, SCK> clock;
+    for (uint8_t c = 0; c < channels; c++) values[c] = 0;
+
+    for (uint8_t bit = 0; bit < 24; bit++)
+    {
+      clock::clockHigh();
+      clock::hold();
+      const bool bits[channels] = { BHX711FastIO<DOUT, SCK>::dataHigh()... };
+      clock::clockLow();
+      for (uint8_t c = 0; c < channels; c++)
+      {
+        values[c] = (values[c] << 1) | bits[c];
+      }
+      clock::hold();
+    }
+
+    while (pulses > 0)
+    {
+      clock::clockHigh();
+      clock::hold();
+      clock::clockLow();
+      clock::hold();
+      pulses--;
+    }
+
+    //  SIGN extend
+    for (uint8_t c = 0; c < channels; c++)
+    {
+      if (values[c] & 0x800000) values[c] -= 0x1000000L;
+    }
+  }
+};
+
+
+//  -- END OF FILE --
@@ -1,1367 +1,1743 @@
-/*
-  Rocket Motor test stand ver 1.6
-  Copyright Boris du Reau 2012-2024
-
-  The following is a datalogger for logging rocket motor thrustcurves.
-
-  The code works with different boards, you need to adjust the config.h file to reflect your board.
-
-
-  This is using a scale load cell as the sensor, a HX711 as the cell amplifier and an Atmega 328 or an STM32
-  The following record the motor thrustcurve and saves it in an EEPROM
-
-
-
-  For the EEPROM 24LC512-I/P - SERIAL EEPROM 512K,24LC512, DIP8
-
-  Number Name ConnectTo     Note
-  1       a0     GND
-  2       a1     GND
-  3       a2     GND
-  4       GND    GND
-  5       SDA    SDA         2kOhm PullUp
-  6       SCL    SCL
-  7       WP     GND
-  8       VCC    (+3v3 ... +5V0)
-
-  The time to write in the EEPROM is 10ms
-
-
-  Major changes on version 1.0
-  Initial version. This is based on my datalogger code and uses the same principles
-  Major Changes on version 1.1
-  Added connection test
-  Major Changes on version 1.2
-  Added casing pressure
-  Major Changes on version 1.3
-  Telemetry fixes
-  Major Changes on version 1.4
-  Ported to ESP32
-  Major Changes on version 1.5
-  Use internal HX711 lib
-  Changed calibration routines
-  Fixed issues with ESP32
-  Major Changes on version 1.6
-  Record second analog input when available
-*/
-
-//Test Stand configuration lib
-#include "config.h"
-#include <Wire.h> //I2C library
-#include "kalman.h"
-#include "beepfunc.h"
-#include "logger_i2c_eeprom.h"
-#include "HX711.h"
-
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-BluetoothSerial SerialBT;
-#endif
-
-
-// HX711 circuit wiring
-#ifdef TESTSTAND
-const int LOADCELL_DOUT_PIN = 3;
-const int LOADCELL_SCK_PIN = 2;
-#endif
-#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
-const int LOADCELL_DOUT_PIN = PB15;
-const int LOADCELL_SCK_PIN = PB14;
-#endif
-
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-const int LOADCELL_DOUT_PIN = 16;
-const int LOADCELL_SCK_PIN = 19;
-#endif
-
-//////////////////////////////////////////////////////////////////////
-// Global variables
-//////////////////////////////////////////////////////////////////////
-
-HX711 scale;
-
-//EEProm address
-logger_I2C_eeprom logger(0x50) ;
-// End address of the 512 eeprom
-long endAddress = 65536;
-// current file number that you are recording
-//int currentFileNbr = 0;
-// EEPROM start address for the thrust curve. Anything before that is the flight index
-long currentMemaddress = 200;
-//stop recording a maximum of 20 seconds after the motor has fired
-long recordingTimeOut = 20000;
-boolean canRecord = true;
-boolean exitRecording = true;
-long currentThrustCurveNbr;
-long currentThrust;
-long currPressure=0;
-
-#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-long currPressure2=0;
-#endif
-long currThrust = 0;
-long initialThrust;
-
-//long thrustDetect;
-boolean motorStarted = false;
-unsigned long initialTime;
-boolean FastReading = false;
-#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
-const int startPin =  PA1;
-#endif
-
-#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
-const int pressurePin = PA7;
-#endif
-
-#ifdef TESTSTANDSTM32V3
-const int pressurePin2 = PA8;
-#endif
-
-#ifdef TESTSTAND
-const int startPin =  10;
-#endif
-
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-const int startPin =  23;
-const int pressurePin = 33;
-#endif
-
-#ifdef TESTSTANDESP32V3
-const int pressurePin2 = 32;
-#endif
-
-int startState = HIGH;
-//telemetry
-boolean telemetryEnable = false;
-long lastTelemetry = 0;
-long lastBattWarning = 0;
-boolean recording = false;
-
-
-void MainMenu();
-/*
-   Float replacement of the map function
-*/
-float map_tofloat(float x, float in_min, float in_max, float out_min, float out_max)
-{
-  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
-}
-
-/*
-
-  ResetGlobalVar()
-
-*/
-void ResetGlobalVar() {
-  exitRecording = false;
-  motorStarted = false;
-}
-
-/*
-
-   initTestStand()
-
-*/
-void initTestStand() {
-
-  ResetGlobalVar();
-  
-  scale.begin(LOADCELL_DOUT_PIN, LOADCELL_SCK_PIN);
-  delay(1000);
-  if (config.calibration_factor != 0)
-    scale.set_scale((float)config.calibration_factor);
-  
-  if (config.current_offset != 0)
-    scale.set_offset( config.current_offset);
-  scale.tare();
-
-  SerialCom.println("Scale tared");
-}
-
-/*
-   ReadThrust()
-*/
-long ReadThrust() {
-  //return  (long) KalmanCalc((abs(scale.get_units()) * 1000));
-  return  (long) ((scale.get_units(5)) * 1000);
-   
-}
-
-#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
-long ReadPressure() {
-
-  float sum = 0;
-  for (int i = 0; i < 20; i++) {
-    int pressure = analogRead(pressurePin);
-
-    sum += (float)map_tofloat( ((float)(pressure * 3300) / (float)4096000 / VOLT_DIVIDER_PRESSURE),
-                               0.5,
-                               4.5,
-                               0.0,
-                               (float)pressureSensorTypeToMaxValue(config.pressure_sensor_type));
-    delay(1);
-  }
-  return (long)  (sum / 20.0);
-}
-#endif
-#if defined TESTSTANDSTM32V3  
-long ReadPressure2() {
-
-  float sum = 0;
-  for (int i = 0; i < 20; i++) {
-    int pressure = analogRead(pressurePin2);
-
-    sum += (float)map_tofloat( ((float)(pressure * 3300) / (float)4096000 / VOLT_DIVIDER_PRESSURE),
-                               0.5,
-                               4.5,
-                               0.0,
-                               (float)pressureSensorTypeToMaxValue(config.pressure_sensor_type2));
-    delay(1);
-  }
-  return (long)  (sum / 20.0);
-}
-#endif
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-long ReadPressure() {
-  
-  int pressure = analogReadAdjusted(pressurePin);
-  long mapped_pressure = (long)map_tofloat( ((float)(pressure * 3300) / (float)4096000 / VOLT_DIVIDER_PRESSURE),
-                               0.5,
-                               4.5,
-                               0.0,
-                               (float)pressureSensorTypeToMaxValue(config.pressure_sensor_type));
-  return mapped_pressure;
-}
-#endif
-#ifdef TESTSTANDESP32V3
-long ReadPressure2() {
-  
-  int pressure = analogReadAdjusted(pressurePin2);
-  long mapped_pressure = (long)map_tofloat( ((float)(pressure * 3300) / (float)4096000 / VOLT_DIVIDER_PRESSURE),
-                               0.5,
-                               4.5,
-                               0.0,
-                               (float)pressureSensorTypeToMaxValue(config.pressure_sensor_type));
-  return mapped_pressure;
-}
-#endif
-/*
-   setup()
-   Initialise the test Stand
-
-*/
-void setup()
-{
-  // initialise the connection
-  Wire.begin();
-
-  //soft configuration
-  boolean softConfigValid = false;
-  // Read test stand softcoded configuration
-  softConfigValid = readTestStandConfig();
-
-  // check if configuration is valid
-  if (!softConfigValid)
-  {
-    //default values
-    defaultConfig();
-    //config.cksum = CheckSumConf(config);
-    writeConfigStruc();
-  }
-
-  // if the baud rate is invalid let's default it
-  if (!CheckValideBaudRate(config.connectionSpeed))
-  {
-    config.connectionSpeed = 38400;
-    config.cksum = CheckSumConf(config);
-    writeConfigStruc();
-  }
-
-#ifdef TESTSTANDSTM32
-  analogReadResolution(12); //// need to review !!!!
-#endif
-#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
-  pinMode(PA7, INPUT_ANALOG);
-  analogReadResolution(12); //// need to review !!!!
-#endif
-
-
-  // init Kalman filter
-  KalmanInit();
-
-  //You can change the baud rate here
-  //and change it to 57600, 115200 etc..
-  config.connectionSpeed = 38400;
-  
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-  Serial.begin(38400);
-  char standName [15];
-  sprintf(standName, "ESP32Stand%i", /*(int)config.altiID*/ 0 );
-  Serial.println(standName);
-  SerialCom.begin(standName);
-#else
- SerialCom.begin(38400);
-#endif 
-  SerialCom.print("pressure_sensor_type" );
-  SerialCom.println(config.pressure_sensor_type);
-  SerialCom.print("connectionSpeed" );
-  SerialCom.println(config.connectionSpeed);
-  
-#ifdef TESTSTAND
-  //software pull up so that all bluetooth modules work!!! took me a good day to figure it out
-  pinMode(PD0, INPUT_PULLUP);
-#endif
-
-  //software pull up so that all bluetooth modules work!!!
-#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
-  pinMode(PB11, INPUT_PULLUP);
-#endif
-
-#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3 || defined TESTSTAND || defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-  pinMode(startPin, INPUT_PULLUP);
-#endif
-
-
-  SerialCom.print(F("Start program\n"));
-  #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-  Serial.print(F("Start program\n"));
-  #endif
-  initTestStand();
-  pinMode(pinSpeaker, OUTPUT);
-
-  digitalWrite(pinSpeaker, LOW);
-
-  //initialisation give the version of the testStand
-  //One long beep per major number and One short beep per minor revision
-  //For example version 1.2 would be one long beep and 2 short beep
-  beepTestStandVersion(MAJOR_VERSION, MINOR_VERSION);
-  SerialCom.print("before calman\n");
-  // let's do some dummy pressure reading
-  // to initialise the Kalman filter
-  for (int i = 0; i < 50; i++) {
-     ReadThrust();
-  }
-
-  //let's read the testStand 0
-  long sum = 0;
-  for (int i = 0; i < 10; i++) {
-    sum += ReadThrust();
-    delay(50);
-  }
-  initialThrust = (sum / 10.0);
-
-  SerialCom.print(F("before read list\n"));
-  int v_ret;
-  v_ret = logger.readThrustCurveList();
-
-  long lastThrustCurveNbr = logger.getLastThrustCurveNbr();
-
-  if (lastThrustCurveNbr < 0)
-  {
-    currentThrustCurveNbr = 0;
-    currentMemaddress = 201;
-  }
-  else
-  {
-    currentMemaddress = logger.getThrustCurveStop(lastThrustCurveNbr) + 1;
-    currentThrustCurveNbr = lastThrustCurveNbr + 1;
-  }
-
-  // check if eeprom is full
-  canRecord = logger.CanRecord();
-  if (!canRecord) {
-    SerialCom.println("Cannot record");
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.println("Cannot record");
-    #endif
-    beginBeepSeq();
-  }
-  SerialCom.println("End init");
-  #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-  Serial.println("End init");
-  #endif
-}
-
-
-
-/*
-   SendTelemetry(long sampleTime, int freq)
-   Send telemetry so that we can plot the motor Thrust
-*/
-void SendTelemetry(long sampleTime, int freq) {
-  char testStandTelem[150] = "";
-
-  char temp[10] = "";
-  if (telemetryEnable && (millis() - lastTelemetry) > freq) {
-    lastTelemetry = millis();
-    int val = 0;
-
-    strcat(testStandTelem, "telemetry," );
-    sprintf(temp, "%i,", currThrust);
-    strcat(testStandTelem, temp);
-
-    sprintf(temp, "%i,", sampleTime);
-    strcat(testStandTelem, temp);
-
-#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
-    pinMode(PB1, INPUT_ANALOG);
-    int batVoltage = analogRead(PB1);
-    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)4096000);
-    dtostrf(bat, 4, 2, temp);
-    strcat(testStandTelem, temp);
-    strcat(testStandTelem, ",");
-#endif
-
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    int batVoltage = analogReadAdjusted(2);
-    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)4096000);
-    dtostrf(bat, 4, 2, temp);
-    strcat(testStandTelem, temp);
-    strcat(testStandTelem, ",");
-#endif
-#ifdef TESTSTAND
-    strcat(testStandTelem, "-1,");
-#endif
-
-    if (!recording) {
-      sprintf(temp, "%i,", (int)(100 * ((float) logger.getLastThrustCurveEndAddress() / endAddress)) );
-    }
-    else {
-      sprintf(temp, "%i,", (int)(100 * ((float) currentMemaddress / endAddress)) );
-    }
-    strcat(testStandTelem, temp);
-    sprintf(temp, "%i,", logger.getLastThrustCurveNbr() + 1 );
-    strcat(testStandTelem, temp);
-
-#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-    sprintf(temp, "%i,", currPressure );
-    strcat(testStandTelem, temp);
-#endif
-#if defined TESTSTAND || defined TESTSTANDSTM32
-    strcat(testStandTelem, "-1,");
-#endif
-#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-    sprintf(temp, "%i,", currPressure2 );
-    strcat(testStandTelem, temp);
-#endif
-    unsigned int chk;
-    chk = msgChk(testStandTelem, sizeof(testStandTelem));
-    sprintf(temp, "%i", chk);
-    strcat(testStandTelem, temp);
-    strcat(testStandTelem, ";\n");
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-      Serial.print("$");
-      Serial.print(testStandTelem);
-    #endif
-    SerialCom.print("$");
-    SerialCom.print(testStandTelem);
-  }
-}
-
-//================================================================
-// Main loop which call the menu
-//================================================================
-void loop()
-{
-  MainMenu();
-}
-
-
-//================================================================
-// Function:  recordThrust()
-// called for normal recording
-//================================================================
-void recordThrust()
-{
-  ResetGlobalVar();
-  telemetryEnable = true;
-  recordingTimeOut = config.endRecordTime * 1000;
-  while (!exitRecording)
-  {
-    //read current thrust
-    currThrust = (ReadThrust() - initialThrust);
-    currPressure = ReadPressure();
-    #if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-    currPressure2 = ReadPressure2();
-    #endif
-    //if (( currThrust > config.startRecordThrust) && !recording )
-    if ( !recording )
-    {
-      recording = true;
-      SendTelemetry(0, 200);
-      // save the time
-      initialTime = millis();
-
-      //resetThrustCurve();
-      if (canRecord)
-      {
-        //Save start address
-        logger.setThrustCurveStartAddress (currentThrustCurveNbr, currentMemaddress);
-        delay(10);
-#ifdef SERIAL_DEBUG
-        SerialCom.println(F("Save start address\n"));
-        SerialCom.println(currentMemaddress);
-        SerialCom.println(currentThrustCurveNbr);
-#endif
-      }
-
-    }
-    unsigned long prevTime = 0;
-
-    // loop until we have reach a thrust of x kg
-    while (recording)
-    {
-      unsigned long currentTime;
-      unsigned long diffTime;
-     
-      currThrust = (ReadThrust() - initialThrust);
-      if (currThrust < 0)
-        currThrust = 0;
-#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-      currPressure = ReadPressure();
-      if (currPressure < 0)
-        currPressure = 0;
-#endif
-
-#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-      currPressure2 = ReadPressure2();
-      if (currPressure2 < 0)
-        currPressure2 = 0;
-#endif
-
-      currentTime = millis() - initialTime;
-
-      SendTelemetry(currentTime, 200);
-      diffTime = currentTime - prevTime;
-      prevTime = currentTime;
-
-
-      if (canRecord)
-      {
-        logger.setThrustCurveTimeData( diffTime);
-        logger.setThrustCurveData(currThrust);
-#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-        logger.setPressureCurveData(currPressure);
-#endif
-
-#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-        logger.setPressureCurveData2(currPressure2);
-#endif
-
-
-        if ( (currentMemaddress + logger.getSizeOfThrustCurveData())  > endAddress) {
-          //memory is full let's save it
-          //save end address
-          logger.setThrustCurveEndAddress (currentThrustCurveNbr, currentMemaddress - 1);
-          canRecord = false;
-        } else {
-          //SerialCom.println("Recording..");
-          //SerialCom.print(currentMemaddress);
-          SendTelemetry(millis() - initialTime, 100 );
-
-          //if (currThrust < 100000) {
-            currentMemaddress = logger.writeFastThrustCurve(currentMemaddress);
-            currentMemaddress++;
-          //}
-        }
-#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTAND || defined TESTSTANDSTM32V3 
-        if (config.standResolution == 3)
-          delay(10);
-        else if (config.standResolution == 2)
-          delay(20);
-        else if (config.standResolution == 1)
-          delay(30);
-        else if (config.standResolution == 0)
-          delay(40);
-#endif
-
-
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-       if (config.standResolution == 3)
-          delay(10);
-        else if (config.standResolution == 2)
-          delay(20);
-        else if (config.standResolution == 1)
-          delay(30);
-        else if (config.standResolution == 0)
-          delay(40);
-#endif
-      }
-
-      //if ((canRecord && (currThrust < config.endRecordThrust) ) || ( (millis() - initialTime) > recordingTimeOut))
-      if ( ( (millis() - initialTime) > recordingTimeOut))
-      {
-        //save end address
-        logger.setThrustCurveEndAddress (currentThrustCurveNbr, currentMemaddress - 1);
-        logger.writeThrustCurveList();
-        delay(10);
-        /*SerialCom.print("last: " );
-          SerialCom.println(currentMemaddress);
-          SerialCom.println(currentThrustCurveNbr);*/
-        exitRecording = true;
-        SendTelemetry(millis() - initialTime, 100);
-        recording = false;
-        SendTelemetry(millis() - initialTime, 100);
-        // we have no more thrust telemetry is not required anymore
-        //telemetryEnable = false;
-        startState = HIGH;
-        resetThrustCurve();
-      }
-
-    } // end while (start recording)
-  } //end while(recording)
-}
-
-
-
-
-//================================================================
-// Main menu to interpret all the commands sent by the altimeter console
-//================================================================
-void MainMenu()
-{
-  //SerialCom.println(F("in main"));
-  char readVal = ' ';
-  int i = 0;
-
-  char commandbuffer[100];
-
-  i = 0;
-  readVal = ' ';
-  while ( readVal != ';')
-  {
-    if (!FastReading)
-    {
-      currThrust = (ReadThrust() - initialThrust);
-      currPressure = ReadPressure();
-      #if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-      currPressure2 = ReadPressure2();
-      #endif
-      if (recording)
-        SendTelemetry(millis() - initialTime, 200);
-      
-      startState = digitalRead(startPin);
-      
-      if (startState == HIGH)
-      {
-        //Serial.print("HIGH");
-        SendTelemetry(0, 500);
-        checkBatVoltage(BAT_MIN_VOLTAGE);
-      }
-      else
-      {
-        //Serial.println("LOW");
-        exitRecording = false;
-        recordThrust();
-      }
-    }
-
-    while (SerialCom.available())
-    {
-      readVal = SerialCom.read();
-      if (readVal != ';' )
-      {
-        if (readVal != '\n')
-          commandbuffer[i++] = readVal;
-      }
-      else
-      {
-        commandbuffer[i++] = '\0';
-        break;
-      }
-    }
-  }
-  interpretCommandBuffer(commandbuffer);
-
-}
-
-
-/*
-
-   This interprets menu commands. This can be used in the command line or
-   this is used by the Android console
-
-   Commands are as folow:
-   a  get all thrustcurve data
-   b  get teststand config
-   c  toggle continuity on and off
-   d  reset teststand config
-   e  erase all saved thrust curve
-   f  FastReading on
-   g  FastReading off
-   h  hello. Does not do much
-   i  unused
-   j  tare the testStand
-   k  unused
-   l  list all thrust curves
-   m  followed by a number turn main loop on/off. if number is 1 then
-      main loop in on else turn it off
-   n  Return the number of recorded thrustcurves in the EEprom
-   r  followed by a number which is the recording number.
-      This will retrieve all data for the specified flight
-   s  write teststand config
-   t  reset teststand config (why?)
-   w  Start or stop recording
-   x  delete last curve
-   y  followed by a number turn telemetry on/off. if number is 1 then
-      telemetry in on else turn it off
-*/
-void interpretCommandBuffer(char *commandbuffer) {
-  SerialCom.println((char*)commandbuffer);
-  //get all ThrustCurve data
-  if (commandbuffer[0] == 'a')
-  {
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$start;\n"));
-    #endif
-    SerialCom.print(F("$start;\n"));
-    int i;
-    ///todo
-    for (i = 0; i < logger.getLastThrustCurveNbr() + 1; i++)
-    {
-      logger.printThrustCurveData(i);
-    }
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$end;\n"));
-    #endif
-    SerialCom.print(F("$end;\n"));
-  }
-  //get Test Stand config
-  else if (commandbuffer[0] == 'b')
-  {
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$start;\n"));
-    #endif
-    SerialCom.print(F("$start;\n"));
-    
-    printTestStandConfig();
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$end;\n"));
-    #endif
-    SerialCom.print(F("$end;\n"));
-  }
-  //prepare calibrate
-  else if (commandbuffer[0] == 'k')
-  {
-    //remove weight
-    scale.tare();
-    //offset = scale.get_offset();
-  }
-  
-  //calibrate
-  else if (commandbuffer[0] == 'c')
-  {
-    char  temp[10];
-    int i = 1;
-    while (commandbuffer[i] != '\0') {
-      temp[i - 1] = commandbuffer[i];
-      i++;
-    }
-    temp[i] = '\0';
-
-    //calibrate(config.calibration_factor, (float)atof(temp));
-    //calibrate(0, (float)atof(temp));
-    SendCalibration(config.current_offset, (long)config.calibration_factor, "Init");
-    scale.calibrate_scale((float)atof(temp), 5);
-    config.current_offset = scale.get_offset();
-    config.calibration_factor = scale.get_scale();
-    SendCalibration(config.current_offset, (long)config.calibration_factor, "In progress");
-    config.cksum = CheckSumConf(config);
-    SendCalibration(config.current_offset, (long)config.calibration_factor, "Done");
-    writeConfigStruc();
-    SerialCom.print(F("$OK;\n"));
-  }
-  //reset test stand config this is equal to t why do I have 2 !!!!
-  else if (commandbuffer[0] == 'd')
-  {
-    defaultConfig();
-    writeConfigStruc();
-    initTestStand();
-  }
-  //this will erase all thrust curves
-  else if (commandbuffer[0] == 'e')
-  {
-    SerialCom.println(F("Erase\n"));
-    logger.clearThrustCurveList();
-    logger.writeThrustCurveList();
-    currentThrustCurveNbr = 0;
-    currentMemaddress = 201;
-  }
-  //FastReading
-  else if (commandbuffer[0] == 'f')
-  {
-    FastReading = true;
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$OK;\n"));
-    #endif
-    SerialCom.print(F("$OK;\n"));
-  }
-  //FastReading off
-  else if (commandbuffer[0] == 'g')
-  {
-    FastReading = false;
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$OK;\n"));
-    #endif
-    SerialCom.print(F("$OK;\n"));
-  }
-  //hello
-  else if (commandbuffer[0] == 'h')
-  {
-    //FastReading = false;
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$OK;\n"));
-    #endif
-    SerialCom.print(F("$OK;\n"));
-  }
-  // unused
-  else if (commandbuffer[0] == 'i')
-  {
-    //exit continuity mode
-  }
-  //tare testStand
-  else if (commandbuffer[0] == 'j')
-  {
-    scale.tare();
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$OK;\n"));
-    #endif
-    SerialCom.print(F("$OK;\n"));
-  }
-  //list all ThrustCurve
-  else if (commandbuffer[0] == 'l')
-  {
-    SerialCom.println(F("ThrustCurve List: \n"));
-    logger.printThrustCurveList();
-  }
-  //mainloop on/off
-  else if (commandbuffer[0] == 'm')
-  {
-    if (commandbuffer[1] == '1') {
-#ifdef SERIAL_DEBUG
-      SerialCom.print(F("main Loop enabled\n"));
-#endif
-      //mainLoopEnable = true;
-    }
-    else {
-#ifdef SERIAL_DEBUG
-      SerialCom.print(F("main loop disabled\n"));
-#endif
-      //mainLoopEnable = false;
-    }
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$OK;\n"));
-    #endif
-    SerialCom.print(F("$OK;\n"));
-  }
-  //Number of ThrustCurve
-  else if (commandbuffer[0] == 'n')
-  {
-    char thrustCurveData[30] = "";
-    char temp[9] = "";
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$start;\n"));
-    #endif
-    SerialCom.print(F("$start;\n"));
-    strcat(thrustCurveData, "nbrOfThrustCurve,");
-    sprintf(temp, "%i,", logger.getLastThrustCurveNbr() + 1 );
-    strcat(thrustCurveData, temp);
-    unsigned int chk = msgChk(thrustCurveData, sizeof(thrustCurveData));
-    sprintf(temp, "%i", chk);
-    strcat(thrustCurveData, temp);
-    strcat(thrustCurveData, ";\n");
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print("$");
-    Serial.print(thrustCurveData);
-    Serial.print(F("$end;\n"));
-    #endif
-    SerialCom.print("$");
-    SerialCom.print(thrustCurveData);
-    SerialCom.print(F("$end;\n"));
-  }
-  // send test tram
-  else if (commandbuffer[0] == 'o')
-  {
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$start;\n"));
-    #endif
-    SerialCom.print(F("$start;\n"));
-    sendTestTram();
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print(F("$end;\n"));
-    #endif
-    SerialCom.print(F("$end;\n"));
-  }
-  //test stand config param
-  //write  config
-  else if (commandbuffer[0] == 'p')
-  {
-    if (writeTestStandConfigV2(commandbuffer)) {
-      #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-      Serial.print(F("$OK;\n"));
-      #endif
-      SerialCom.print(F("$OK;\n"));
-    }
-    else {
-      #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-      Serial.print(F("$KO;\n"));
-      #endif
-      SerialCom.print(F("$KO;\n"));
-    }
-  }
-  else if (commandbuffer[0] == 'q')
-  {
-    writeConfigStruc();
-    readTestStandConfig();
-    initTestStand();
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-      Serial.print(F("$OK;\n"));
-    #endif
-    SerialCom.print(F("$OK;\n"));
-    
-  }
-  //this will read one Thrust curve
-  else if (commandbuffer[0] == 'r')
-  {
-    char temp[3];
-    temp[0] = commandbuffer[1];
-
-    if (commandbuffer[2] != '\0')
-    {
-      temp[1] = commandbuffer[2];
-      temp[2] = '\0';
-    }
-    else
-      temp[1] = '\0';
-
-    if (atol(temp) > -1)
-    {
-      SerialCom.print(F("$start;\n"));
-      logger.printThrustCurveData(atoi(temp));
-      SerialCom.print(F("$end;\n"));
-    }
-    else
-      SerialCom.println(F("not a valid ThrustCurve"));
-  }
-  //write test stand config
-  else if (commandbuffer[0] == 's')
-  {
-    /* if (writeTestStandConfig(commandbuffer)) {
-       SerialCom.print(F("$OK;\n"));
-       readTestStandConfig();
-       initTestStand();
-      }
-      else {
-       SerialCom.print(F("$KO;\n"));
-      }*/
-  }
-  //reset config and set it to default
-  else if (commandbuffer[0] == 't')
-  {
-    //reset config
-    defaultConfig();
-    writeConfigStruc();
-    initTestStand();
-    SerialCom.print(F("config reseted\n"));
-  }
-  // check memory
-   else if (commandbuffer[0] == 'u')
-  {
-    int memSize = logger.checkMemorySize();
-    SerialCom.print(F("Memory size: "));
-    SerialCom.println(memSize);
-    
-    long errors = logger.checkMemoryErrors(65500);
-    SerialCom.print(F("Nbr of errors: "));
-    SerialCom.println(errors);
-  }
-  // Recording
-  else if (commandbuffer[0] == 'w')
-  {
-    SerialCom.println(F("Recording \n"));
-    recordThrust();
-  }
-  //delete last curve
-  else if (commandbuffer[0] == 'x')
-  {
-    logger.eraseLastThrustCurve();
-    logger.readThrustCurveList();
-    long lastThrustCurveNbr = logger.getLastThrustCurveNbr();
-    if (lastThrustCurveNbr < 0)
-    {
-      currentThrustCurveNbr = 0;
-      currentMemaddress = 201;
-    }
-    else
-    {
-      currentMemaddress = logger.getThrustCurveStop(lastThrustCurveNbr) + 1;
-      currentThrustCurveNbr = lastThrustCurveNbr + 1;
-    }
-    canRecord = logger.CanRecord();
-  }
-  //telemetry on/off
-  else if (commandbuffer[0] == 'y')
-  {
-    if (commandbuffer[1] == '1') {
-      SerialCom.print(F("Telemetry enabled\n"));
-      telemetryEnable = true;
-    }
-    else {
-      SerialCom.print(F("Telemetry disabled\n"));
-      telemetryEnable = false;
-    }
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-      Serial.print(F("$OK;\n"));
-    #endif
-    SerialCom.print(F("$OK;\n"));
-  }
-  // empty command
-  else if (commandbuffer[0] == ' ')
-  {
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-      Serial.print(F("$KO;\n"));
-    #endif
-    SerialCom.print(F("$K0;\n"));
-  }
-  else
-  {
-    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-      Serial.print(F("$UNKNOWN;"));
-    Serial.println(commandbuffer[0]);
-    #endif
-    SerialCom.print(F("$UNKNOWN;"));
-    SerialCom.println(commandbuffer[0]);
-  }
-}
-/*
-
-   re-nitialise all ThrustCurve related global variables
-
-*/
-void resetThrustCurve() {
-  // recording = false;
-
-  logger.readThrustCurveList();
-  long lastThrustCurveNbr = logger.getLastThrustCurveNbr();
-  if (lastThrustCurveNbr < 0)
-  {
-    currentThrustCurveNbr = 0;
-    currentMemaddress = 201;
-  }
-  else
-  {
-    currentMemaddress = logger.getThrustCurveStop(lastThrustCurveNbr) + 1;
-    currentThrustCurveNbr = lastThrustCurveNbr + 1;
-  }
-  canRecord = logger.CanRecord();
-}
-
-/*
-   Check if the battery voltage is OK.
-   If not warn the user so that the battery does not get
-   damaged by over discharging
-*/
-void checkBatVoltage(float minVolt) {
-#if defined TESTSTANDSTM32
-  if ((millis() - lastBattWarning) > 10000) {
-    lastBattWarning = millis();
-    pinMode(PB1, INPUT_ANALOG);
-    int batVoltage = analogRead(PB1);
-
-    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)4096000);
-
-    if (bat < minVolt) {
-      for (int i = 0; i < 10; i++)
-      {
-        tone(pinSpeaker, 1600, 1000);
-        delay(50);
-        noTone(pinSpeaker);
-      }
-      delay(1000);
-    }
-  }
-#endif
-
-#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
-  if ((millis() - lastBattWarning) > 10000) {
-    lastBattWarning = millis();
-    pinMode(PB1, INPUT_ANALOG);
-    int batVoltage = analogRead(PB1);
-
-    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)4096000);
-
-    if (bat < minVolt) {
-      for (int i = 0; i < 10; i++)
-      {
-        tone(pinSpeaker, 1600, 1000);
-        delay(50);
-        noTone(pinSpeaker);
-      }
-      delay(1000);
-    }
-    // also check the pressure sensor
-    // var if 0 PSI of if greater than 100
-    if(currPressure == 0 || currPressure > 100) {
-      for (int i = 0; i < 10; i++)
-      {
-        tone(pinSpeaker, 1000, 1000);
-        delay(50);
-        noTone(pinSpeaker);
-      }
-      delay(1000);
-    }
-  }
-#endif
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-if ((millis() - lastBattWarning) > 10000) {
-    lastBattWarning = millis();
-    
-    double batVoltage =analogReadAdjusted(2);
-    
-    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)4096000);
-
-    if (bat < minVolt) {
-      for (int i = 0; i < 10; i++)
-      {
-        tone(pinSpeaker, 1600, 1000);
-        noTone(pinSpeaker);
-        delay(50);
-      }
-      delay(1000);
-    }
-    // also check the pressure sensor
-    // var if 0 PSI of if greater than 100
-    if(currPressure == 0 || currPressure > 100) {
-      for (int i = 0; i < 10; i++)
-      {
-        tone(pinSpeaker, 1000, 1000);
-        
-        noTone(pinSpeaker);
-        delay(50);
-      }
-      delay(1000);
-    }
-  }
-#endif
-}
-
-/*
-   Calibrate the test stand
-*/
-/*void calibrate(float calibration_factor , float CALWEIGHT) {
-  long currentOffset;
-  float LB2KG  = 0.45352;
-  
-  currentOffset = offset; //scale.get_offset();
-  
-  SendCalibration(currentOffset, (long)calibration_factor, "Init");
-  boolean done = false;
-  uint8_t flipDirCount = 0;
-  int8_t direction = 1;
-  uint8_t dirScale = 100;
-  double data = abs(scale.get_units());
-  double prevData = data;
-
-  while (!done)
-  {
-    // get data
-    data = abs(scale.get_units());
-   
-    // if not match
-    if (abs(data - CALWEIGHT) >= 0.01)
-    {
-      if (abs(data - CALWEIGHT) < abs(prevData - CALWEIGHT) && direction != 1 && data < CALWEIGHT)
-      {
-        direction = 1;
-        flipDirCount++;
-      }
-      else if (abs(data - CALWEIGHT) >= abs(prevData - CALWEIGHT) && direction != -1 && data > CALWEIGHT)
-      {
-        direction = -1;
-        flipDirCount++;
-      }
-
-      if (flipDirCount > 2)
-      {
-        if (dirScale != 1)
-        {
-          dirScale = dirScale / 10;
-          flipDirCount = 0;
-        }
-      }
-      // set new factor
-      calibration_factor += direction * dirScale;
-
-      scale.set_scale(calibration_factor);
-      SendCalibration(currentOffset, (long)calibration_factor, "In progress");
-      //short delay
-      delay(5);
-      // keep old data
-      prevData = data;
-    }
-    // if match
-    else
-    {
-      //Serial.println("NEW currentOffset = " + String(currentOffset));
-      //Serial.println("NEW calibration_factor = " + String(calibration_factor));
-      config.calibration_factor = (long) calibration_factor;
-      config.current_offset = currentOffset;
-      SendCalibration(currentOffset, (long)calibration_factor, "Done");
-      //writeConfigStruc();
-      done = true;
-
-    }
-
-  } // end while
-
-  scale.set_offset(currentOffset);
-  scale.set_scale((float)config.calibration_factor);
-  SendCalibration(currentOffset, (long)calibration_factor, "Done");
-
-}*/
-
-void SendCalibration(long calibration_offset, long calibration_factor, char *flag) {
-  char testStandCalibration[50] = "";
-
-  char temp[10] = "";
-
-  strcat(testStandCalibration, "calibration," );
-  sprintf(temp, "%i,", calibration_offset);
-  strcat(testStandCalibration, temp);
-  sprintf(temp, "%i,", calibration_factor);
-  strcat(testStandCalibration, temp);
-  strcat(testStandCalibration, flag);
-  strcat(testStandCalibration, ",");
-
-  unsigned int chk;
-  chk = msgChk(testStandCalibration, sizeof(testStandCalibration));
-  sprintf(temp, "%i", chk);
-  strcat(testStandCalibration, temp);
-  strcat(testStandCalibration, ";\n");
-  #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-  Serial.print("$");
-  Serial.print(testStandCalibration);
-  #endif
-  SerialCom.print("$");
-  SerialCom.print(testStandCalibration);
-}
-
-/*
-    Test tram
-*/
-void sendTestTram() {
-
-  char altiTest[100] = "";
-  char temp[10] = "";
-
-  strcat(altiTest, "testTrame," );
-  strcat(altiTest, "Bear altimeters are the best!!!!,");
-  unsigned int chk;
-  chk = msgChk(altiTest, sizeof(altiTest));
-  sprintf(temp, "%i", chk);
-  strcat(altiTest, temp);
-  strcat(altiTest, ";\n");
-
-  #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-  Serial.print("$");
-  Serial.print(altiTest);
-  #endif
-  SerialCom.print("$");
-  SerialCom.print(altiTest);
-
-}
-
-int pressureSensorTypeToMaxValue( int type) {
-  //"100 PSI", "150 PSI", "200 PSI", "300 PSI", "500 PSI", "1000 PSI", "1600 PSI"
-  int maxValue = 100;
-  switch (type)
-  {
-    case 0:
-      maxValue = 100;
-      break;
-    case 1:
-      maxValue = 100;
-      break;
-    case 2:
-      maxValue = 150;
-      break;
-    case 3:
-      maxValue = 200;
-      break;
-    case 4:
-      maxValue = 300;
-      break;
-    case 5:
-      maxValue = 500;
-      break;
-    case 6:
-      maxValue = 1000;
-      break;
-    case 7:
-      maxValue = 1600;
-      break;
-  }
-
-  return maxValue;
-}
-
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-double analogReadAdjusted(byte pinNumber){
-
-  // Specify the adjustment factors.
-  const double f1 = 1.7111361460487501e+001;
-  const double f2 = 4.2319467860421662e+000;
-  const double f3 = -1.9077375643188468e-002;
-  const double f4 = 5.4338055402459246e-005;
-  const double f5 = -8.7712931081088873e-008;
-  const double f6 = 8.7526709101221588e-011;
-  const double f7 = -5.6536248553232152e-014;
-  const double f8 = 2.4073049082147032e-017;
-  const double f9 = -6.7106284580950781e-021;
-  const double f10 = 1.1781963823253708e-024;
-  const double f11 = -1.1818752813719799e-028;
-  const double f12 = 5.1642864552256602e-033;
-
-  // Specify the number of loops for one measurement.
-  const int loops = 40;
-
-  // Specify the delay between the loops.
-  const int loopDelay = 1;
-
-  // Initialize the used variables.
-  int counter = 1;
-  int inputValue = 0;
-  double totalInputValue = 0;
-  double averageInputValue = 0;
-
-  // Loop to get the average of different analog values.
-  for (counter = 1; counter <= loops; counter++) {
-
-    // Read the analog value.
-    inputValue = analogRead(pinNumber);
-
-    // Add the analog value to the total.
-    totalInputValue += inputValue;
-
-    // Wait some time after each loop.
-    delay(loopDelay);
-  }
-
-  // Calculate the average input value.
-  averageInputValue = totalInputValue / loops;
-
-  // Calculate and return the adjusted input value.
-  return f1 + f2 * pow(averageInputValue, 1) + f3 * pow(averageInputValue, 2) + f4 * pow(averageInputValue, 3) + f5 * pow(averageInputValue, 4) + f6 * pow(averageInputValue, 5) + f7 * pow(averageInputValue, 6) + f8 * pow(averageInputValue, 7) + f9 * pow(averageInputValue, 8) + f10 * pow(averageInputValue, 9) + f11 * pow(averageInputValue, 10) + f12 * pow(averageInputValue, 11);
-}
-#endif
-/*int checkMemoryErrors(int memorySize) {
-  int errors = 0;
-  
-  return errors;
-}
-
-int checkMemorySize() {
-  int memorySize = 0;
-
-  return memorySize;
-}*/
+/*
+  Rocket Motor test stand ver 1.6
+  Copyright Boris du Reau 2012-2024
+
+  The following is a datalogger for logging rocket motor thrustcurves.
+
+  The code works with different boards, you need to adjust the config.h file to reflect your board.
+
+
+  This is using a scale load cell as the sensor, a HX711 as the cell amplifier and an Atmega 328 or an STM32
+  The following record the motor thrustcurve and saves it in an EEPROM
+
+
+
+  For the EEPROM 24LC512-I/P - SERIAL EEPROM 512K,24LC512, DIP8
+
+  Number Name ConnectTo     Note
+  1       a0     GND
+  2       a1     GND
+  3       a2     GND
+  4       GND    GND
+  5       SDA    SDA         2kOhm PullUp
+  6       SCL    SCL
+  7       WP     GND
+  8       VCC    (+3v3 ... +5V0)
+
+  The time to write in the EEPROM is 10ms
+
+
+  Major changes on version 1.0
+  Initial version. This is based on my datalogger code and uses the same principles
+  Major Changes on version 1.1
+  Added connection test
+  Major Changes on version 1.2
+  Added casing pressure
+  Major Changes on version 1.3
+  Telemetry fixes
+  Major Changes on version 1.4
+  Ported to ESP32
+  Major Changes on version 1.5
+  Use internal HX711 lib
+  Changed calibration routines
+  Fixed issues with ESP32
+  Major Changes on version 1.6
+  Record second analog input when available
+*/
+
+//Test Stand configuration lib
+#include "config.h"
+#include <Wire.h> //I2C library
+#include "kalman.h"
+#include "beepfunc.h"
+#include "logger_i2c_eeprom.h"
+#include "BHX711.h"
+#include "BHX711FastIO.h"
+#include "sampleclock.h"
+#include "adc_dma.h"
+#include "pressure.h"
+#include "ringbuffer.h"
+#include "trigger.h"
+
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+BluetoothSerial SerialBT;
+#endif
+
+
+// HX711 circuit wiring
+// LoadCellIO drives the same pins straight from the port registers
+#ifdef TESTSTAND
+const int LOADCELL_DOUT_PIN = 3;
+const int LOADCELL_SCK_PIN = 2;
+typedef BHX711FastIO<LOADCELL_DOUT_PIN, LOADCELL_SCK_PIN> LoadCellIO;
+#endif
+#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+const int LOADCELL_DOUT_PIN = PB15;
+const int LOADCELL_SCK_PIN = PB14;
+// the fast IO takes the PinName of the same pins
+typedef BHX711FastIO<PB_15, PB_14> LoadCellIO;
+#endif
+
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+const int LOADCELL_DOUT_PIN = 16;
+const int LOADCELL_SCK_PIN = 19;
+typedef BHX711FastIO<LOADCELL_DOUT_PIN, LOADCELL_SCK_PIN> LoadCellIO;
+#endif
+
+#if NBR_LOADCELLS > 1
+// extra load cells on the same clock line, adjust them to your wiring
+// the _IO versions are what LoadCellIO takes
+#ifdef TESTSTAND
+#define LOADCELL_DOUT_IO LOADCELL_DOUT_PIN
+#define LOADCELL_SCK_IO LOADCELL_SCK_PIN
+#define LOADCELL_DOUT2 4
+#define LOADCELL_DOUT2_IO LOADCELL_DOUT2
+#define LOADCELL_DOUT3 5
+#define LOADCELL_DOUT3_IO LOADCELL_DOUT3
+#define LOADCELL_DOUT4 6
+#define LOADCELL_DOUT4_IO LOADCELL_DOUT4
+#endif
+#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+#define LOADCELL_DOUT_IO PB_15
+#define LOADCELL_SCK_IO PB_14
+#define LOADCELL_DOUT2 PB13
+#define LOADCELL_DOUT2_IO PB_13
+#define LOADCELL_DOUT3 PB12
+#define LOADCELL_DOUT3_IO PB_12
+#define LOADCELL_DOUT4 PB5
+#define LOADCELL_DOUT4_IO PB_5
+#endif
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+#define LOADCELL_DOUT_IO LOADCELL_DOUT_PIN
+#define LOADCELL_SCK_IO LOADCELL_SCK_PIN
+#define LOADCELL_DOUT2 17
+#define LOADCELL_DOUT2_IO LOADCELL_DOUT2
+#define LOADCELL_DOUT3 18
+#define LOADCELL_DOUT3_IO LOADCELL_DOUT3
+#define LOADCELL_DOUT4 25
+#define LOADCELL_DOUT4_IO LOADCELL_DOUT4
+#endif
+
+#if NBR_LOADCELLS == 2
+const int LOADCELL_EXTRA_DOUT_PINS[] = {LOADCELL_DOUT2};
+typedef BHX711MultiFastIO<LOADCELL_SCK_IO, LOADCELL_DOUT_IO, LOADCELL_DOUT2_IO> LoadCellBurstIO;
+#elif NBR_LOADCELLS == 3
+const int LOADCELL_EXTRA_DOUT_PINS[] = {LOADCELL_DOUT2, LOADCELL_DOUT3};
+typedef BHX711MultiFastIO<LOADCELL_SCK_IO, LOADCELL_DOUT_IO, LOADCELL_DOUT2_IO, LOADCELL_DOUT3_IO> LoadCellBurstIO;
+#else
+const int LOADCELL_EXTRA_DOUT_PINS[] = {LOADCELL_DOUT2, LOADCELL_DOUT3, LOADCELL_DOUT4};
+typedef BHX711MultiFastIO<LOADCELL_SCK_IO, LOADCELL_DOUT_IO, LOADCELL_DOUT2_IO, LOADCELL_DOUT3_IO, LOADCELL_DOUT4_IO> LoadCellBurstIO;
+#endif
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Global variables
+//////////////////////////////////////////////////////////////////////
+
+BHX711 scale;
+
+//EEProm address
+logger_I2C_eeprom logger(0x50) ;
+// End address of the 512 eeprom
+// last address the curves can use, the curve directory is after it
+long endAddress = 65536;
+// current file number that you are recording
+//int currentFileNbr = 0;
+// EEPROM start address for the thrust curve. Anything before that is the flight index
+long currentMemaddress = 200;
+//stop recording a maximum of 20 seconds after the motor has fired
+long recordingTimeOut = 20000;
+boolean canRecord = true;
+boolean exitRecording = true;
+long currentThrustCurveNbr;
+long currentThrust;
+long currPressure=0;
+// Kalman filtered pressures of the samples being recorded
+long currPressureFiltered=0;
+
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+long currPressure2=0;
+long currPressure2Filtered=0;
+#endif
+long currThrust = 0;
+long initialThrust;
+
+//long thrustDetect;
+boolean motorStarted = false;
+unsigned long initialTime;
+boolean FastReading = false;
+#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+const int startPin =  PA1;
+#endif
+
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+const int pressurePin = PA7;
+#endif
+
+#ifdef TESTSTANDSTM32V3
+const int pressurePin2 = PA8;
+#endif
+
+#if defined TESTSTANDSTM32V2
+const int adcDmaPins[] = {pressurePin, PB1};
+#endif
+#if defined TESTSTANDSTM32V3
+const int adcDmaPins[] = {pressurePin, pressurePin2, PB1};
+#endif
+
+#ifdef TESTSTAND
+const int startPin =  10;
+#endif
+
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+const int startPin =  23;
+const int pressurePin = 33;
+#endif
+
+#ifdef TESTSTANDESP32V3
+const int pressurePin2 = 32;
+#endif
+
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+// loop() runs on core 1
+#define ACQUISITION_CORE 0
+RingBuffer<ThrustCurveDataStruct, 64> sampleQueue;
+TaskHandle_t acquisitionTask = NULL;
+volatile boolean acquisitionRunning = false;
+#endif
+
+// samples taken while waiting for the thrust to rise
+RingBuffer<ThrustCurveDataStruct, PRETRIGGER_SAMPLES> preTrigger;
+// adaptive storage: last sample stored, samples dropped since and the
+// time they cover
+ThrustCurveDataStruct adaptiveLast;
+int adaptiveSkipped;
+long adaptiveTime;
+
+int startState = HIGH;
+//telemetry
+boolean telemetryEnable = false;
+long lastTelemetry = 0;
+long lastBattWarning = 0;
+boolean recording = false;
+
+
+void MainMenu();
+
+/*
+
+  ResetGlobalVar()
+
+*/
+void ResetGlobalVar() {
+  exitRecording = false;
+  motorStarted = false;
+}
+
+/*
+
+   initTestStand()
+
+*/
+void initTestStand() {
+
+  ResetGlobalVar();
+  
+#if NBR_LOADCELLS > 1
+  if (scale.get_channels() == 1) {
+    for (int i = 0; i < NBR_LOADCELLS - 1; i++)
+      scale.add_channel(LOADCELL_EXTRA_DOUT_PINS[i]);
+  }
+  scale.begin_burst<LoadCellBurstIO>(LOADCELL_DOUT_PIN, LOADCELL_SCK_PIN);
+#else
+  scale.begin<LoadCellIO>(LOADCELL_DOUT_PIN, LOADCELL_SCK_PIN);
+#endif
+  delay(1000);
+  if (config.calibration_factor != 0)
+    scale.set_scale((float)config.calibration_factor);
+  
+  if (config.current_offset != 0)
+    scale.set_offset( config.current_offset);
+#if NBR_LOADCELLS > 1
+  for (int i = 0; i < NBR_LOADCELLS - 1; i++) {
+    if (config.channel_calibration_factor[i] != 0)
+      scale.set_scale_channel(i + 1, (float)config.channel_calibration_factor[i]);
+    if (config.channel_offset[i] != 0)
+      scale.set_offset_channel(i + 1, config.channel_offset[i]);
+  }
+#endif
+  scale.tare_converged(CALIBRATION_TOLERANCE, CALIBRATION_TIMEOUT);
+  setThrustFilter();
+
+  SerialCom.println("Scale tared");
+}
+
+/*
+   setThrustFilter()
+   Pick the HX711 filter from the config
+*/
+void setThrustFilter() {
+  if (config.decimationRatio > 0) {
+    if (scale.get_mode() != HX711_DECIMATE_MODE || scale.get_decimation() != config.decimationRatio)
+      scale.set_decimate_mode(config.decimationRatio);
+  }
+  else
+    scale.set_average_mode();
+}
+
+/*
+   ReadThrust()
+*/
+long ReadThrust() {
+  //return  (long) KalmanCalc((abs(scale.get_units()) * 1000));
+  uint8_t times = 5;
+  // a full window of new conversions
+  if (scale.get_mode() == HX711_DECIMATE_MODE)
+    times = scale.get_decimation();
+  // when recording use all the conversions queued since the last sample
+  if (scale.is_interrupt_mode()) {
+    times = scale.available();
+    if (times == 0)
+      times = 1;
+  }
+#ifdef FIXED_POINT_THRUST
+  return scale.get_milli_units(times);
+#else
+  return  (long) ((scale.get_units(times)) * 1000);
+#endif
+   
+}
+
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+long ReadPressure() {
+
+  // average of the last ADC_DMA_SCANS conversions, see adc_dma.cpp
+  return pressureFromRaw(0, adcDmaRead(pressurePin));
+}
+#endif
+#if defined TESTSTANDSTM32V3  
+long ReadPressure2() {
+
+  // average of the last ADC_DMA_SCANS conversions, see adc_dma.cpp
+  return pressureFromRaw(1, adcDmaRead(pressurePin2));
+}
+#endif
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+long ReadPressure() {
+  
+  return pressureFromRaw(0, analogReadAdjusted(pressurePin));
+}
+#endif
+#ifdef TESTSTANDESP32V3
+long ReadPressure2() {
+  
+  return pressureFromRaw(1, analogReadAdjusted(pressurePin2));
+}
+#endif
+/*
+   setup()
+   Initialise the test Stand
+
+*/
+void setup()
+{
+  // initialise the connection and the curve memory
+  logger.begin();
+
+  //soft configuration
+  boolean softConfigValid = false;
+  // Read test stand softcoded configuration
+  softConfigValid = readTestStandConfig();
+
+  // check if configuration is valid
+  if (!softConfigValid)
+  {
+    //default values
+    defaultConfig();
+    //config.cksum = CheckSumConf(config);
+    writeConfigStruc();
+  }
+
+  // if the baud rate is invalid let's default it
+  if (!CheckValideBaudRate(config.connectionSpeed))
+  {
+    config.connectionSpeed = 38400;
+    config.cksum = CheckSumConf(config);
+    writeConfigStruc();
+  }
+
+#ifdef TESTSTANDSTM32
+  analogReadResolution(12); //// need to review !!!!
+#endif
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+  analogReadResolution(12); //// need to review !!!!
+  // the pressure and battery inputs are sampled in the background,
+  // adcDmaRead() uses analogRead() if the DMA does not start
+  boolean adcDmaStarted = adcDmaBegin(adcDmaPins, sizeof(adcDmaPins) / sizeof(adcDmaPins[0]));
+#endif
+
+  // find the size of the eeprom, config.eepromSize if it is blank
+  logger.probeCapacity(checkEEPromEndAdress(config.eepromSize));
+
+  // init Kalman filter
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+  for (int i = 0; i < PRESSURE_CHANNELS; i++)
+    pressureFilter[i].reset();
+#endif
+
+  //You can change the baud rate here
+  //and change it to 57600, 115200 etc..
+  config.connectionSpeed = 38400;
+  
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  Serial.begin(38400);
+  char standName [15];
+  sprintf(standName, "ESP32Stand%i", /*(int)config.altiID*/ 0 );
+  Serial.println(standName);
+  SerialCom.begin(standName);
+#else
+ SerialCom.begin(38400);
+#endif 
+  SerialCom.print("pressure_sensor_type" );
+  SerialCom.println(config.pressure_sensor_type);
+  SerialCom.print("connectionSpeed" );
+  SerialCom.println(config.connectionSpeed);
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+  if (!adcDmaStarted)
+    SerialCom.println(F("ADC DMA not started, using analogRead"));
+#endif
+  
+#ifdef TESTSTAND
+  //software pull up so that all bluetooth modules work!!! took me a good day to figure it out
+  pinMode(PD0, INPUT_PULLUP);
+#endif
+
+  //software pull up so that all bluetooth modules work!!!
+#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+  pinMode(PB11, INPUT_PULLUP);
+#endif
+
+#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3 || defined TESTSTAND || defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  pinMode(startPin, INPUT_PULLUP);
+#endif
+
+
+  SerialCom.print(F("Start program\n"));
+  #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  Serial.print(F("Start program\n"));
+  #endif
+  initTestStand();
+  pinMode(pinSpeaker, OUTPUT);
+
+  digitalWrite(pinSpeaker, LOW);
+
+  //initialisation give the version of the testStand
+  //One long beep per major number and One short beep per minor revision
+  //For example version 1.2 would be one long beep and 2 short beep
+  beepTestStandVersion(MAJOR_VERSION, MINOR_VERSION);
+  SerialCom.print("before calman\n");
+  // let's do some dummy pressure reading
+  // to initialise the Kalman filter
+  for (int i = 0; i < 50; i++) {
+     ReadThrust();
+  }
+
+  //let's read the testStand 0
+  long sum = 0;
+  for (int i = 0; i < 10; i++) {
+    sum += ReadThrust();
+    delay(50);
+  }
+  initialThrust = (sum / 10.0);
+
+  SerialCom.print(F("before read list\n"));
+  int v_ret;
+  v_ret = logger.readThrustCurveList();
+
+  long lastThrustCurveNbr = logger.getLastThrustCurveNbr();
+
+  currentThrustCurveNbr = lastThrustCurveNbr + 1;
+  currentMemaddress = logger.getNextCurveStart();
+
+  // check if eeprom is full
+  canRecord = logger.CanRecord();
+  endAddress = logger.getDataEnd();
+  if (!canRecord) {
+    SerialCom.println("Cannot record");
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.println("Cannot record");
+    #endif
+    beginBeepSeq();
+  }
+  SerialCom.println("End init");
+  #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  Serial.println("End init");
+  #endif
+}
+
+
+
+/*
+   SendTelemetry(long sampleTime, int freq)
+   Send telemetry so that we can plot the motor Thrust
+*/
+void SendTelemetry(long sampleTime, int freq) {
+  char testStandTelem[150] = "";
+
+  char temp[10] = "";
+  if (telemetryEnable && (millis() - lastTelemetry) > freq) {
+    lastTelemetry = millis();
+    int val = 0;
+
+    strcat(testStandTelem, "telemetry," );
+    sprintf(temp, "%i,", currThrust);
+    strcat(testStandTelem, temp);
+
+    sprintf(temp, "%i,", sampleTime);
+    strcat(testStandTelem, temp);
+
+#if defined TESTSTANDSTM32
+    pinMode(PB1, INPUT_ANALOG);
+    int batVoltage = analogRead(PB1);
+    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)4096000);
+    dtostrf(bat, 4, 2, temp);
+    strcat(testStandTelem, temp);
+    strcat(testStandTelem, ",");
+#endif
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+    long batVoltage = adcDmaRead(PB1);
+    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)(4096000L * 16));
+    dtostrf(bat, 4, 2, temp);
+    strcat(testStandTelem, temp);
+    strcat(testStandTelem, ",");
+#endif
+
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    long batVoltage = analogReadAdjusted(2);
+    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)(4096000L * 16));
+    dtostrf(bat, 4, 2, temp);
+    strcat(testStandTelem, temp);
+    strcat(testStandTelem, ",");
+#endif
+#ifdef TESTSTAND
+    strcat(testStandTelem, "-1,");
+#endif
+
+    if (!recording) {
+      sprintf(temp, "%i,", (int)(100 * ((float) logger.getLastThrustCurveEndAddress() / endAddress)) );
+    }
+    else {
+      sprintf(temp, "%i,", (int)(100 * ((float) currentMemaddress / endAddress)) );
+    }
+    strcat(testStandTelem, temp);
+    sprintf(temp, "%i,", logger.getLastThrustCurveNbr() + 1 );
+    strcat(testStandTelem, temp);
+
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    // the filtered value reads better on the plot while recording
+    sprintf(temp, "%i,", recording ? currPressureFiltered : currPressure );
+    strcat(testStandTelem, temp);
+#endif
+#if defined TESTSTAND || defined TESTSTANDSTM32
+    strcat(testStandTelem, "-1,");
+#endif
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    sprintf(temp, "%i,", recording ? currPressure2Filtered : currPressure2 );
+    strcat(testStandTelem, temp);
+#endif
+    unsigned int chk;
+    chk = msgChk(testStandTelem, sizeof(testStandTelem));
+    sprintf(temp, "%i", chk);
+    strcat(testStandTelem, temp);
+    strcat(testStandTelem, ";\n");
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+      Serial.print("$");
+      Serial.print(testStandTelem);
+    #endif
+    SerialCom.print("$");
+    SerialCom.print(testStandTelem);
+  }
+}
+
+//================================================================
+// Main loop which call the menu
+//================================================================
+void loop()
+{
+  MainMenu();
+}
+
+
+//================================================================
+// Function:  recordThrust()
+// called for normal recording
+//================================================================
+void recordThrust()
+{
+  ResetGlobalVar();
+  telemetryEnable = true;
+  recordingTimeOut = config.endRecordTime * 1000;
+  // the decimation ratio may have changed since the last recording
+  setThrustFilter();
+  // let the HX711 interrupt queue every conversion so that none are lost
+  // while we are busy writing to the eeprom or sending telemetry
+  scale.start_interrupt_mode();
+  // the sample rate now comes from a hardware timer rather than from delays
+  sampleClockStart(sampleRateFromResolution(config.standResolution));
+  unsigned long prevTime = 0;
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  startAcquisitionTask();
+#endif
+  // wait for the thrust to rise, keeping the samples from before it so
+  // that the ignition is in the curve
+  long preTriggerSpan = 0;
+  long triggerRecord = -1;
+  long stopRecord = -1;
+  triggerArm();
+  if (!waitForTrigger(prevTime, preTriggerSpan))
+  {
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    stopAcquisitionTask();
+#endif
+    sampleClockStop();
+    scale.stop_interrupt_mode();
+    startState = HIGH;
+    exitRecording = true;
+  }
+  while (!exitRecording)
+  {
+    if ( !recording )
+    {
+      recording = true;
+      SendTelemetry(0, 200);
+      // save the time of the conversion we started with
+      initialTime = scale.last_read();
+
+      //resetThrustCurve();
+      if (canRecord)
+      {
+        //Save start address
+        logger.setThrustCurveStartAddress (currentThrustCurveNbr, currentMemaddress);
+        logger.setThrustCurveFormat (currentThrustCurveNbr, config.storageFormat);
+        currentMemaddress = logger.writeThrustCurveHeader(currentThrustCurveNbr, currentMemaddress, recordChannels(),
+                            1000000L / sampleClockRate(), config.unit, config.calibration_factor, config.current_offset,
+                            preTriggerSpan);
+#ifdef SERIAL_DEBUG
+        SerialCom.println(F("Save start address\n"));
+        SerialCom.println(currentMemaddress);
+        SerialCom.println(currentThrustCurveNbr);
+#endif
+      }
+      // the pre-trigger samples go first, the last one is the trigger
+      ThrustCurveDataStruct sample;
+      adaptiveStart();
+      while (preTrigger.pop(sample))
+      {
+        boolean trigger = preTrigger.isEmpty();
+        if (trigger)
+          triggerRecord = logger.getThrustCurveRecords();
+        if (adaptiveKeep(sample, trigger))
+          storeSample(sample);
+      }
+    }
+    unsigned long checkpointTime = millis();
+
+    // loop until we have reach a thrust of x kg
+    while (recording)
+    {
+      ThrustCurveDataStruct sample;
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+      // the samples are taken on the other core, we only store them
+      storeQueuedSamples(stopRecord);
+      logger.poll();
+      SendTelemetry(millis() - initialTime, 200);
+      delay(1);
+#else
+      // finish the eeprom page write while waiting for the next tick
+      while (!sampleClockDue())
+        logger.poll();
+      // wait for the next tick of the sample clock
+      unsigned long tick = sampleClockWait();
+      // time of the tick, so that all records are on the same time grid
+      unsigned long currentTime = sampleClockMillis(tick);
+      acquireSample(sample, currentTime, prevTime);
+      SendTelemetry(currentTime, 200);
+      if (adaptiveKeep(sample, followBurn(sample, stopRecord)))
+        storeSample(sample);
+#endif
+      // save how far the curve is so that a power loss only loses the
+      // last second of it
+      if (canRecord && millis() - checkpointTime >= THRUSTCURVE_CHECKPOINT_MS)
+      {
+        logger.checkpointThrustCurve();
+        checkpointTime = millis();
+      }
+
+      if (triggerState() == TRIGGER_STOPPED || ( (millis() - initialTime) > recordingTimeOut))
+      {
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+        stopAcquisitionTask();
+        // store what is left in the queue
+        storeQueuedSamples(stopRecord);
+#endif
+        // write the last partial page
+        logger.flushThrustCurve();
+        //save end address
+        logger.setThrustCurveEndAddress (currentThrustCurveNbr, currentMemaddress - 1);
+        // the burnout is only known if the thrust went under endRecordThrust
+        logger.setThrustCurveMarks(triggerRecord, triggerState() == TRIGGER_BURNING ? -1 : stopRecord);
+        logger.writeThrustCurveList();
+        delay(10);
+        /*SerialCom.print("last: " );
+          SerialCom.println(currentMemaddress);
+          SerialCom.println(currentThrustCurveNbr);*/
+        exitRecording = true;
+        sampleClockStop();
+        scale.stop_interrupt_mode();
+        SendSampleStats();
+#ifdef SERIAL_DEBUG
+        SerialCom.print(F("HX711 overruns: "));
+        SerialCom.println(scale.get_overruns());
+        SerialCom.print(F("HX711 read timeouts: "));
+        SerialCom.println(scale.get_timeouts());
+        SerialCom.print(F("Eeprom write errors: "));
+        SerialCom.println(logger.getWriteErrors());
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+        SerialCom.print(F("Sample queue overruns: "));
+        SerialCom.println(sampleQueue.getOverruns());
+#endif
+#endif
+        SendTelemetry(millis() - initialTime, 100);
+        recording = false;
+        SendTelemetry(millis() - initialTime, 100);
+        // we have no more thrust telemetry is not required anymore
+        //telemetryEnable = false;
+        startState = HIGH;
+        resetThrustCurve();
+      }
+
+    } // end while (start recording)
+  } //end while(recording)
+}
+
+/*
+   commandWaiting()
+   true if a command came in. The line ends and spaces sent after the
+   last one are dropped, they must not disarm the trigger
+*/
+boolean commandWaiting()
+{
+  while (SerialCom.available())
+  {
+    int c = SerialCom.peek();
+    if (c != '\r' && c != '\n' && c != ' ')
+      return true;
+    SerialCom.read();
+  }
+  return false;
+}
+
+/*
+   waitForTrigger()
+   Keep the last config.preTriggerTime ms of samples in preTrigger until
+   the trigger starts the recording, the last one is the trigger sample.
+   preTriggerSpan is then the time they cover. Returns false if a command
+   came in first.
+*/
+boolean waitForTrigger(unsigned long &prevTime, long &preTriggerSpan)
+{
+  unsigned long depth = ((unsigned long)config.preTriggerTime * sampleClockRate()) / 1000;
+  if (depth < 1)
+    depth = 1;
+  if (depth > PRETRIGGER_SAMPLES - 1)
+    depth = PRETRIGGER_SAMPLES - 1;
+  preTrigger.clear();
+  preTriggerSpan = 0;
+  while (!commandWaiting())
+  {
+    ThrustCurveDataStruct sample;
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    if (!sampleQueue.pop(sample))
+    {
+      SendTelemetry(0, 500);
+      delay(1);
+      continue;
+    }
+#else
+    unsigned long tick = sampleClockWait();
+    acquireSample(sample, sampleClockMillis(tick), prevTime);
+#endif
+    if (preTrigger.available() >= depth)
+    {
+      ThrustCurveDataStruct oldest;
+      preTrigger.pop(oldest);
+      preTriggerSpan -= oldest.diffTime;
+    }
+    preTrigger.push(sample);
+    preTriggerSpan += sample.diffTime;
+    if (triggerUpdate(sample.thrust, sample.diffTime) != TRIGGER_ARMED)
+      return true;
+    SendTelemetry(0, 500);
+  }
+  return false;
+}
+
+/*
+   followBurn()
+   run the trigger on a sample taken after the start, before it is
+   stored. stopRecord is the record the thrust last went under
+   config.endRecordThrust at, returns true for the sample that record
+   is for
+*/
+boolean followBurn(const ThrustCurveDataStruct &sample, long &stopRecord)
+{
+  uint8_t before = triggerState();
+  if (triggerUpdate(sample.thrust, sample.diffTime) == TRIGGER_BURNOUT && before != TRIGGER_BURNOUT)
+  {
+    stopRecord = logger.getThrustCurveRecords();
+    return true;
+  }
+  return false;
+}
+
+/*
+   adaptiveStart()
+   the next sample is stored whatever it is
+*/
+void adaptiveStart()
+{
+  adaptiveSkipped = -1;
+  adaptiveTime = 0;
+}
+
+/*
+   adaptiveKeep()
+   With config.adaptiveThreshold set, a sample whose thrust is within it
+   of the last sample stored, and its pressures within
+   config.adaptivePressureThreshold PSI, is only stored once every
+   config.adaptiveDivider samples, so the steady part of the burn takes
+   less room than the ignition and the tail-off. The time of the samples
+   dropped goes in the diffTime of the next one stored.
+   Returns false if the sample is to be dropped, force to keep it.
+*/
+boolean adaptiveKeep(ThrustCurveDataStruct &sample, boolean force)
+{
+  if (config.adaptiveThreshold <= 0 || config.adaptiveDivider <= 1)
+    return true;
+  boolean keep = force || adaptiveSkipped < 0 || adaptiveSkipped + 1 >= config.adaptiveDivider ||
+                 labs(sample.thrust - adaptiveLast.thrust) > config.adaptiveThreshold;
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+  if (config.adaptivePressureThreshold > 0)
+  {
+    keep = keep || labs(sample.casing_pressure - adaptiveLast.casing_pressure) > config.adaptivePressureThreshold;
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    keep = keep || labs(sample.casing_pressure2 - adaptiveLast.casing_pressure2) > config.adaptivePressureThreshold;
+#endif
+  }
+#endif
+  if (!keep)
+  {
+    adaptiveSkipped++;
+    adaptiveTime += sample.diffTime;
+    return false;
+  }
+  sample.diffTime += adaptiveTime;
+  adaptiveTime = 0;
+  adaptiveSkipped = 0;
+  adaptiveLast = sample;
+  return true;
+}
+
+/*
+   acquireSample()
+   Read the sensors for the sample taken at currentTime
+   and fill the record with it
+*/
+void acquireSample(ThrustCurveDataStruct &sample, unsigned long currentTime, unsigned long &prevTime)
+{
+  currThrust = (ReadThrust() - initialThrust);
+  if (currThrust < 0)
+    currThrust = 0;
+  sample.thrust = currThrust;
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+  currPressure = ReadPressure();
+  if (currPressure < 0)
+    currPressure = 0;
+  sample.casing_pressure = currPressure;
+  currPressureFiltered = (long)pressureFilter[0].update(currPressure);
+#endif
+
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+  currPressure2 = ReadPressure2();
+  if (currPressure2 < 0)
+    currPressure2 = 0;
+  sample.casing_pressure2 = currPressure2;
+  currPressure2Filtered = (long)pressureFilter[1].update(currPressure2);
+  // the HX711 filter has already been run by ReadThrust()
+  long thrustFiltered = (long)(scale.get_units_filtered() * 1000) - initialThrust;
+  if (thrustFiltered < 0)
+    thrustFiltered = 0;
+  sample.thrust_filtered = thrustFiltered;
+#endif
+
+#if NBR_LOADCELLS > 1
+  // read in the same bursts as the thrust above, they can be negative
+  scale.get_milli_units_channels(sample.thrust_channel);
+#endif
+
+  sample.diffTime = currentTime - prevTime;
+  prevTime = currentTime;
+}
+
+/*
+   storeSample()
+   write a record in the eeprom until it is full
+*/
+void storeSample(const ThrustCurveDataStruct &sample)
+{
+  if (canRecord)
+  {
+    logger.setThrustCurveTimeData(sample.diffTime);
+    logger.setThrustCurveData(sample.thrust);
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    logger.setPressureCurveData(sample.casing_pressure);
+#endif
+
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    logger.setPressureCurveData2(sample.casing_pressure2);
+    logger.setThrustCurveDataFiltered(sample.thrust_filtered);
+#endif
+#if NBR_LOADCELLS > 1
+    for (int i = 1; i < NBR_LOADCELLS; i++)
+      logger.setThrustCurveDataChannel(i, sample.thrust_channel[i - 1]);
+#endif
+
+    // more than one record if sample clock ticks were missed and the
+    // time is not stored
+    int records = logger.getRecordsForSample(sample.diffTime);
+    for (int r = 0; r < records && canRecord; r++) {
+      if ( (currentMemaddress + logger.getSizeOfThrustCurveData())  > endAddress) {
+        //memory is full let's save it
+        logger.flushThrustCurve();
+        //save end address
+        logger.setThrustCurveEndAddress (currentThrustCurveNbr, currentMemaddress - 1);
+        canRecord = false;
+      } else {
+        //SerialCom.println("Recording..");
+        //SerialCom.print(currentMemaddress);
+        SendTelemetry(millis() - initialTime, 100 );
+
+        //if (currThrust < 100000) {
+          currentMemaddress = logger.writeFastThrustCurve(currentMemaddress);
+        //}
+      }
+    }
+  }
+}
+
+/*
+   recordChannels()
+   channels to store in the curve, the pressure sensors that are not
+   connected are left out
+*/
+uint8_t recordChannels()
+{
+  uint8_t channels = config.recordChannels | THRUSTCURVE_CH_THRUST;
+  // the records of the adaptive storage are not on the sample clock grid
+  if (config.adaptiveThreshold > 0 && config.adaptiveDivider > 1)
+    channels |= THRUSTCURVE_CH_TIME;
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+  if (config.pressure_sensor_type == 0)
+    channels &= ~THRUSTCURVE_CH_PRESSURE;
+#endif
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+  if (config.pressure_sensor_type2 == 0)
+    channels &= ~THRUSTCURVE_CH_PRESSURE2;
+#endif
+  return channels;
+}
+
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+/*
+   Acquisition task
+   While recording the sensors are read by a task pinned to core 0 and
+   the records are passed to loop(), which runs on core 1, through
+   sampleQueue. Eeprom writes, telemetry and commands stay on core 1 so
+   that they cannot slow down the sample rate.
+*/
+void acquisitionLoop(void *param)
+{
+  unsigned long prevTime = 0;
+  while (acquisitionRunning)
+  {
+    unsigned long tick = sampleClockWait();
+    ThrustCurveDataStruct sample;
+    acquireSample(sample, sampleClockMillis(tick), prevTime);
+    // if loop() is too slow the record is dropped and counted
+    sampleQueue.push(sample);
+  }
+  acquisitionTask = NULL;
+  vTaskDelete(NULL);
+}
+
+/*
+   storeQueuedSamples()
+   store the samples queued by the acquisition task, up to the end of the
+   burn
+*/
+void storeQueuedSamples(long &stopRecord)
+{
+  ThrustCurveDataStruct sample;
+  while (triggerState() != TRIGGER_STOPPED && sampleQueue.pop(sample))
+  {
+    if (adaptiveKeep(sample, followBurn(sample, stopRecord)))
+      storeSample(sample);
+  }
+}
+
+void startAcquisitionTask()
+{
+  sampleQueue.clear();
+  sampleQueue.resetOverruns();
+  acquisitionRunning = true;
+  // above the bluetooth host tasks, below the bluetooth controller
+  xTaskCreatePinnedToCore(acquisitionLoop, "acquisition", 4096, NULL,
+                          configMAX_PRIORITIES - 3, &acquisitionTask, ACQUISITION_CORE);
+}
+
+void stopAcquisitionTask()
+{
+  acquisitionRunning = false;
+  while (acquisitionTask != NULL)
+    delay(1);
+}
+#endif
+
+//================================================================
+// Main menu to interpret all the commands sent by the altimeter console
+//================================================================
+void MainMenu()
+{
+  //SerialCom.println(F("in main"));
+  char readVal = ' ';
+  int i = 0;
+
+  char commandbuffer[100];
+
+  i = 0;
+  readVal = ' ';
+  while ( readVal != ';')
+  {
+    if (!FastReading)
+    {
+      currThrust = (ReadThrust() - initialThrust);
+      #if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+      currPressure = ReadPressure();
+      #endif
+      #if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+      currPressure2 = ReadPressure2();
+      #endif
+      if (recording)
+        SendTelemetry(millis() - initialTime, 200);
+      
+      startState = digitalRead(startPin);
+      
+      if (startState == HIGH)
+      {
+        //Serial.print("HIGH");
+        SendTelemetry(0, 500);
+        checkBatVoltage(BAT_MIN_VOLTAGE);
+      }
+      else
+      {
+        //Serial.println("LOW");
+        exitRecording = false;
+        recordThrust();
+      }
+    }
+
+    while (SerialCom.available())
+    {
+      readVal = SerialCom.read();
+      if (readVal != ';' )
+      {
+        if (readVal != '\n')
+          commandbuffer[i++] = readVal;
+      }
+      else
+      {
+        commandbuffer[i++] = '\0';
+        break;
+      }
+    }
+  }
+  interpretCommandBuffer(commandbuffer);
+
+}
+
+
+/*
+
+   This interprets menu commands. This can be used in the command line or
+   this is used by the Android console
+
+   Commands are as folow:
+   a  get all thrustcurve data
+   b  get teststand config
+   c  toggle continuity on and off
+   d  reset teststand config
+   e  erase all saved thrust curve
+   f  FastReading on
+   g  FastReading off
+   h  hello. Does not do much
+   i  unused
+   j  tare the testStand
+   k  unused
+   l  list all thrust curves
+   m  followed by a number turn main loop on/off. if number is 1 then
+      main loop in on else turn it off
+   n  Return the number of recorded thrustcurves in the EEprom
+   r  followed by a number which is the recording number.
+      This will retrieve all data for the specified flight
+   s  write teststand config
+   t  reset teststand config (why?)
+   w  Start or stop recording
+   x  delete last curve
+   y  followed by a number turn telemetry on/off. if number is 1 then
+      telemetry in on else turn it off
+*/
+void interpretCommandBuffer(char *commandbuffer) {
+  SerialCom.println((char*)commandbuffer);
+  //get all ThrustCurve data
+  if (commandbuffer[0] == 'a')
+  {
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$start;\n"));
+    #endif
+    SerialCom.print(F("$start;\n"));
+    int i;
+    ///todo
+    for (i = 0; i < logger.getLastThrustCurveNbr() + 1; i++)
+    {
+      logger.printThrustCurveData(i);
+    }
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$end;\n"));
+    #endif
+    SerialCom.print(F("$end;\n"));
+  }
+  //get Test Stand config
+  else if (commandbuffer[0] == 'b')
+  {
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$start;\n"));
+    #endif
+    SerialCom.print(F("$start;\n"));
+    
+    printTestStandConfig();
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$end;\n"));
+    #endif
+    SerialCom.print(F("$end;\n"));
+  }
+  //prepare calibrate
+  else if (commandbuffer[0] == 'k')
+  {
+    //remove weight
+    scale.tare_converged(CALIBRATION_TOLERANCE, CALIBRATION_TIMEOUT);
+    //offset = scale.get_offset();
+  }
+  
+  //calibrate
+  else if (commandbuffer[0] == 'c')
+  {
+    char  temp[10];
+    int i = 1;
+    while (commandbuffer[i] != '\0' && commandbuffer[i] != ',') {
+      temp[i - 1] = commandbuffer[i];
+      i++;
+    }
+    temp[i - 1] = '\0';
+
+#if NBR_LOADCELLS > 1
+    // c<weight>,<channel> calibrates one of the other load cells
+    int channel = 0;
+    if (commandbuffer[i] == ',')
+      channel = atoi(&commandbuffer[i + 1]);
+    if (channel > 0 && channel < NBR_LOADCELLS) {
+      SendCalibration(config.channel_offset[channel - 1], config.channel_calibration_factor[channel - 1], "Init", -1);
+      scale.calibrate_scale_channel(channel, (float)atof(temp), CALIBRATION_TOLERANCE, CALIBRATION_TIMEOUT);
+      config.channel_offset[channel - 1] = scale.get_offset_channel(channel);
+      config.channel_calibration_factor[channel - 1] = scale.get_scale_channel(channel);
+      long error = calibrationError(config.channel_calibration_factor[channel - 1]);
+      SendCalibration(config.channel_offset[channel - 1], config.channel_calibration_factor[channel - 1], "In progress", error);
+      config.cksum = CheckSumConf(config);
+      SendCalibration(config.channel_offset[channel - 1], config.channel_calibration_factor[channel - 1], "Done", error);
+      writeConfigStruc();
+      SerialCom.print(F("$OK;\n"));
+      return;
+    }
+#endif
+    //calibrate(config.calibration_factor, (float)atof(temp));
+    //calibrate(0, (float)atof(temp));
+    SendCalibration(config.current_offset, (long)config.calibration_factor, "Init", -1);
+    scale.calibrate_scale_converged((float)atof(temp), CALIBRATION_TOLERANCE, CALIBRATION_TIMEOUT);
+    config.current_offset = scale.get_offset();
+    config.calibration_factor = scale.get_scale();
+    long error = calibrationError(config.calibration_factor);
+    SendCalibration(config.current_offset, (long)config.calibration_factor, "In progress", error);
+    config.cksum = CheckSumConf(config);
+    SendCalibration(config.current_offset, (long)config.calibration_factor, "Done", error);
+    writeConfigStruc();
+    SerialCom.print(F("$OK;\n"));
+  }
+  //reset test stand config this is equal to t why do I have 2 !!!!
+  else if (commandbuffer[0] == 'd')
+  {
+    defaultConfig();
+    writeConfigStruc();
+    initTestStand();
+  }
+  //this will erase all thrust curves
+  else if (commandbuffer[0] == 'e')
+  {
+    SerialCom.println(F("Erase\n"));
+    logger.clearThrustCurveList();
+    logger.writeThrustCurveList();
+    currentThrustCurveNbr = 0;
+    currentMemaddress = logger.getNextCurveStart();
+    canRecord = logger.CanRecord();
+    endAddress = logger.getDataEnd();
+  }
+  //FastReading
+  else if (commandbuffer[0] == 'f')
+  {
+    FastReading = true;
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$OK;\n"));
+    #endif
+    SerialCom.print(F("$OK;\n"));
+  }
+  //FastReading off
+  else if (commandbuffer[0] == 'g')
+  {
+    FastReading = false;
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$OK;\n"));
+    #endif
+    SerialCom.print(F("$OK;\n"));
+  }
+  //hello
+  else if (commandbuffer[0] == 'h')
+  {
+    //FastReading = false;
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$OK;\n"));
+    #endif
+    SerialCom.print(F("$OK;\n"));
+  }
+  // unused
+  else if (commandbuffer[0] == 'i')
+  {
+    //exit continuity mode
+  }
+  //tare testStand
+  else if (commandbuffer[0] == 'j')
+  {
+    scale.tare_converged(CALIBRATION_TOLERANCE, CALIBRATION_TIMEOUT);
+    // the new offset and how well it is known
+    SendCalibration(scale.get_offset(), (long)config.calibration_factor, "Tare", calibrationError(config.calibration_factor));
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$OK;\n"));
+    #endif
+    SerialCom.print(F("$OK;\n"));
+  }
+  //list all ThrustCurve
+  else if (commandbuffer[0] == 'l')
+  {
+    SerialCom.println(F("ThrustCurve List: \n"));
+    logger.printThrustCurveList();
+  }
+  //mainloop on/off
+  else if (commandbuffer[0] == 'm')
+  {
+    if (commandbuffer[1] == '1') {
+#ifdef SERIAL_DEBUG
+      SerialCom.print(F("main Loop enabled\n"));
+#endif
+      //mainLoopEnable = true;
+    }
+    else {
+#ifdef SERIAL_DEBUG
+      SerialCom.print(F("main loop disabled\n"));
+#endif
+      //mainLoopEnable = false;
+    }
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$OK;\n"));
+    #endif
+    SerialCom.print(F("$OK;\n"));
+  }
+  //Number of ThrustCurve
+  else if (commandbuffer[0] == 'n')
+  {
+    char thrustCurveData[30] = "";
+    char temp[9] = "";
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$start;\n"));
+    #endif
+    SerialCom.print(F("$start;\n"));
+    strcat(thrustCurveData, "nbrOfThrustCurve,");
+    sprintf(temp, "%i,", logger.getLastThrustCurveNbr() + 1 );
+    strcat(thrustCurveData, temp);
+    unsigned int chk = msgChk(thrustCurveData, sizeof(thrustCurveData));
+    sprintf(temp, "%i", chk);
+    strcat(thrustCurveData, temp);
+    strcat(thrustCurveData, ";\n");
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print("$");
+    Serial.print(thrustCurveData);
+    Serial.print(F("$end;\n"));
+    #endif
+    SerialCom.print("$");
+    SerialCom.print(thrustCurveData);
+    SerialCom.print(F("$end;\n"));
+  }
+  // send test tram
+  else if (commandbuffer[0] == 'o')
+  {
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$start;\n"));
+    #endif
+    SerialCom.print(F("$start;\n"));
+    sendTestTram();
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print(F("$end;\n"));
+    #endif
+    SerialCom.print(F("$end;\n"));
+  }
+  //test stand config param
+  //write  config
+  else if (commandbuffer[0] == 'p')
+  {
+    if (writeTestStandConfigV2(commandbuffer)) {
+      #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+      Serial.print(F("$OK;\n"));
+      #endif
+      SerialCom.print(F("$OK;\n"));
+    }
+    else {
+      #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+      Serial.print(F("$KO;\n"));
+      #endif
+      SerialCom.print(F("$KO;\n"));
+    }
+  }
+  else if (commandbuffer[0] == 'q')
+  {
+    writeConfigStruc();
+    readTestStandConfig();
+    initTestStand();
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+      Serial.print(F("$OK;\n"));
+    #endif
+    SerialCom.print(F("$OK;\n"));
+    
+  }
+  //this will read one Thrust curve
+  else if (commandbuffer[0] == 'r')
+  {
+    char temp[3];
+    temp[0] = commandbuffer[1];
+
+    if (commandbuffer[2] != '\0')
+    {
+      temp[1] = commandbuffer[2];
+      temp[2] = '\0';
+    }
+    else
+      temp[1] = '\0';
+
+    if (atol(temp) > -1)
+    {
+      SerialCom.print(F("$start;\n"));
+      logger.printThrustCurveData(atoi(temp));
+      SerialCom.print(F("$end;\n"));
+    }
+    else
+      SerialCom.println(F("not a valid ThrustCurve"));
+  }
+  //write test stand config
+  else if (commandbuffer[0] == 's')
+  {
+    /* if (writeTestStandConfig(commandbuffer)) {
+       SerialCom.print(F("$OK;\n"));
+       readTestStandConfig();
+       initTestStand();
+      }
+      else {
+       SerialCom.print(F("$KO;\n"));
+      }*/
+  }
+  //reset config and set it to default
+  else if (commandbuffer[0] == 't')
+  {
+    //reset config
+    defaultConfig();
+    writeConfigStruc();
+    initTestStand();
+    SerialCom.print(F("config reseted\n"));
+  }
+  // check memory
+   else if (commandbuffer[0] == 'u')
+  {
+    int memSize = logger.checkMemorySize();
+    SerialCom.print(F("Memory size: "));
+    SerialCom.println(memSize);
+    
+    long errors = logger.checkMemoryErrors(logger.getCapacity());
+    SerialCom.print(F("Nbr of errors: "));
+    SerialCom.println(errors);
+  }
+  // Recording
+  else if (commandbuffer[0] == 'w')
+  {
+    SerialCom.println(F("Recording \n"));
+    recordThrust();
+  }
+  //delete last curve
+  else if (commandbuffer[0] == 'x')
+  {
+    logger.eraseLastThrustCurve();
+    logger.readThrustCurveList();
+    long lastThrustCurveNbr = logger.getLastThrustCurveNbr();
+    currentThrustCurveNbr = lastThrustCurveNbr + 1;
+    currentMemaddress = logger.getNextCurveStart();
+    canRecord = logger.CanRecord();
+    endAddress = logger.getDataEnd();
+  }
+  //telemetry on/off
+  else if (commandbuffer[0] == 'y')
+  {
+    if (commandbuffer[1] == '1') {
+      SerialCom.print(F("Telemetry enabled\n"));
+      telemetryEnable = true;
+    }
+    else {
+      SerialCom.print(F("Telemetry disabled\n"));
+      telemetryEnable = false;
+    }
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+      Serial.print(F("$OK;\n"));
+    #endif
+    SerialCom.print(F("$OK;\n"));
+  }
+  // empty command
+  else if (commandbuffer[0] == ' ')
+  {
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+      Serial.print(F("$KO;\n"));
+    #endif
+    SerialCom.print(F("$K0;\n"));
+  }
+  else
+  {
+    #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+      Serial.print(F("$UNKNOWN;"));
+    Serial.println(commandbuffer[0]);
+    #endif
+    SerialCom.print(F("$UNKNOWN;"));
+    SerialCom.println(commandbuffer[0]);
+  }
+}
+/*
+
+   re-nitialise all ThrustCurve related global variables
+
+*/
+void resetThrustCurve() {
+  // recording = false;
+
+  logger.readThrustCurveList();
+  long lastThrustCurveNbr = logger.getLastThrustCurveNbr();
+  currentThrustCurveNbr = lastThrustCurveNbr + 1;
+  currentMemaddress = logger.getNextCurveStart();
+  canRecord = logger.CanRecord();
+  endAddress = logger.getDataEnd();
+}
+
+/*
+   Check if the battery voltage is OK.
+   If not warn the user so that the battery does not get
+   damaged by over discharging
+*/
+void checkBatVoltage(float minVolt) {
+#if defined TESTSTANDSTM32
+  if ((millis() - lastBattWarning) > 10000) {
+    lastBattWarning = millis();
+    pinMode(PB1, INPUT_ANALOG);
+    int batVoltage = analogRead(PB1);
+
+    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)4096000);
+
+    if (bat < minVolt) {
+      for (int i = 0; i < 10; i++)
+      {
+        tone(pinSpeaker, 1600, 1000);
+        delay(50);
+        noTone(pinSpeaker);
+      }
+      delay(1000);
+    }
+  }
+#endif
+
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+  if ((millis() - lastBattWarning) > 10000) {
+    lastBattWarning = millis();
+    long batVoltage = adcDmaRead(PB1);
+
+    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)(4096000L * 16));
+
+    if (bat < minVolt) {
+      for (int i = 0; i < 10; i++)
+      {
+        tone(pinSpeaker, 1600, 1000);
+        delay(50);
+        noTone(pinSpeaker);
+      }
+      delay(1000);
+    }
+    // also check the pressure sensor
+    // var if 0 PSI of if greater than 100
+    if(currPressure == 0 || currPressure > 100) {
+      for (int i = 0; i < 10; i++)
+      {
+        tone(pinSpeaker, 1000, 1000);
+        delay(50);
+        noTone(pinSpeaker);
+      }
+      delay(1000);
+    }
+  }
+#endif
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+if ((millis() - lastBattWarning) > 10000) {
+    lastBattWarning = millis();
+    
+    long batVoltage = analogReadAdjusted(2);
+    
+    float bat = VOLT_DIVIDER * ((float)(batVoltage * 3300) / (float)(4096000L * 16));
+
+    if (bat < minVolt) {
+      for (int i = 0; i < 10; i++)
+      {
+        tone(pinSpeaker, 1600, 1000);
+        noTone(pinSpeaker);
+        delay(50);
+      }
+      delay(1000);
+    }
+    // also check the pressure sensor
+    // var if 0 PSI of if greater than 100
+    if(currPressure == 0 || currPressure > 100) {
+      for (int i = 0; i < 10; i++)
+      {
+        tone(pinSpeaker, 1000, 1000);
+        
+        noTone(pinSpeaker);
+        delay(50);
+      }
+      delay(1000);
+    }
+  }
+#endif
+}
+
+/*
+   Calibrate the test stand
+*/
+/*void calibrate(float calibration_factor , float CALWEIGHT) {
+  long currentOffset;
+  float LB2KG  = 0.45352;
+  
+  currentOffset = offset; //scale.get_offset();
+  
+  SendCalibration(currentOffset, (long)calibration_factor, "Init");
+  boolean done = false;
+  uint8_t flipDirCount = 0;
+  int8_t direction = 1;
+  uint8_t dirScale = 100;
+  double data = abs(scale.get_units());
+  double prevData = data;
+
+  while (!done)
+  {
+    // get data
+    data = abs(scale.get_units());
+   
+    // if not match
+    if (abs(data - CALWEIGHT) >= 0.01)
+    {
+      if (abs(data - CALWEIGHT) < abs(prevData - CALWEIGHT) && direction != 1 && data < CALWEIGHT)
+      {
+        direction = 1;
+        flipDirCount++;
+      }
+      else if (abs(data - CALWEIGHT) >= abs(prevData - CALWEIGHT) && direction != -1 && data > CALWEIGHT)
+      {
+        direction = -1;
+        flipDirCount++;
+      }
+
+      if (flipDirCount > 2)
+      {
+        if (dirScale != 1)
+        {
+          dirScale = dirScale / 10;
+          flipDirCount = 0;
+        }
+      }
+      // set new factor
+      calibration_factor += direction * dirScale;
+
+      scale.set_scale(calibration_factor);
+      SendCalibration(currentOffset, (long)calibration_factor, "In progress");
+      //short delay
+      delay(5);
+      // keep old data
+      prevData = data;
+    }
+    // if match
+    else
+    {
+      //Serial.println("NEW currentOffset = " + String(currentOffset));
+      //Serial.println("NEW calibration_factor = " + String(calibration_factor));
+      config.calibration_factor = (long) calibration_factor;
+      config.current_offset = currentOffset;
+      SendCalibration(currentOffset, (long)calibration_factor, "Done");
+      //writeConfigStruc();
+      done = true;
+
+    }
+
+  } // end while
+
+  scale.set_offset(currentOffset);
+  scale.set_scale((float)config.calibration_factor);
+  SendCalibration(currentOffset, (long)calibration_factor, "Done");
+
+}*/
+
+void SendCalibration(long calibration_offset, long calibration_factor, char *flag, long error) {
+  char testStandCalibration[80] = "";
+
+  char temp[15] = "";
+
+  strcat(testStandCalibration, "calibration," );
+  sprintf(temp, "%i,", calibration_offset);
+  strcat(testStandCalibration, temp);
+  sprintf(temp, "%i,", calibration_factor);
+  strcat(testStandCalibration, temp);
+  strcat(testStandCalibration, flag);
+  strcat(testStandCalibration, ",");
+  // standard error of the calibration, -1 if not known yet
+  sprintf(temp, "%i,", error);
+  strcat(testStandCalibration, temp);
+
+  unsigned int chk;
+  chk = msgChk(testStandCalibration, sizeof(testStandCalibration));
+  sprintf(temp, "%i", chk);
+  strcat(testStandCalibration, temp);
+  strcat(testStandCalibration, ";\n");
+  #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  Serial.print("$");
+  Serial.print(testStandCalibration);
+  #endif
+  SerialCom.print("$");
+  SerialCom.print(testStandCalibration);
+}
+
+/*
+   calibrationError()
+   Standard error of the last tare or calibration in thrust units * 1000,
+   ie the same unit as the recorded thrust
+*/
+long calibrationError(long calibration_factor) {
+  if (calibration_factor == 0)
+    return -1;
+  return (long)(scale.get_std_error() * 1000 / abs(calibration_factor));
+}
+
+/*
+   SendSampleStats()
+   Report how well the sample clock was kept during the last recording
+   rate, ticks, missed ticks, worst and mean delay in us
+*/
+void SendSampleStats() {
+  char sampleStats[80] = "";
+  char temp[12] = "";
+  SampleClockStats stats;
+
+  sampleClockGetStats(stats);
+  strcat(sampleStats, "samplestats,");
+  sprintf(temp, "%u,", sampleClockRate());
+  strcat(sampleStats, temp);
+  sprintf(temp, "%lu,", stats.ticks);
+  strcat(sampleStats, temp);
+  sprintf(temp, "%lu,", stats.overruns);
+  strcat(sampleStats, temp);
+  sprintf(temp, "%lu,", stats.maxLateUs);
+  strcat(sampleStats, temp);
+  sprintf(temp, "%lu,", stats.meanLateUs);
+  strcat(sampleStats, temp);
+
+  unsigned int chk;
+  chk = msgChk(sampleStats, sizeof(sampleStats));
+  sprintf(temp, "%i", chk);
+  strcat(sampleStats, temp);
+  strcat(sampleStats, ";\n");
+  #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  Serial.print("$");
+  Serial.print(sampleStats);
+  #endif
+  SerialCom.print("$");
+  SerialCom.print(sampleStats);
+}
+
+/*
+    Test tram
+*/
+void sendTestTram() {
+
+  char altiTest[100] = "";
+  char temp[10] = "";
+
+  strcat(altiTest, "testTrame," );
+  strcat(altiTest, "Bear altimeters are the best!!!!,");
+  unsigned int chk;
+  chk = msgChk(altiTest, sizeof(altiTest));
+  sprintf(temp, "%i", chk);
+  strcat(altiTest, temp);
+  strcat(altiTest, ";\n");
+
+  #if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  Serial.print("$");
+  Serial.print(altiTest);
+  #endif
+  SerialCom.print("$");
+  SerialCom.print(altiTest);
+
+}
+
+/*int checkMemoryErrors(int memorySize) {
+  int errors = 0;
+  
+  return errors;
+}
+
+int checkMemorySize() {
+  int memorySize = 0;
+
+  return memorySize;
+}*/
@@ -0,0 +1,153 @@
+#include "adc_dma.h"
+
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+static ADC_HandleTypeDef adcHandle;
+static DMA_HandleTypeDef adcDmaHandle;
+// two halves of ADC_DMA_SCANS scans
+static volatile uint16_t adcBuffer[2 * ADC_DMA_SCANS * ADC_DMA_MAX_CHANNELS];
+static int adcPins[ADC_DMA_MAX_CHANNELS];
+static uint8_t adcNbrChannels = 0;
+// last half filled by the DMA, 0 or 1, none yet if > 1
+static volatile uint8_t adcReadyHalf = 2;
+static boolean adcDmaRunning = false;
+
+extern "C" void DMA1_Channel1_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&adcDmaHandle);
+}
+
+extern "C" void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  adcReadyHalf = 0;
+}
+
+extern "C" void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  adcReadyHalf = 1;
+}
+
+/*
+   adcDmaBegin()
+   Start scanning the pins. Pins without an ADC channel are skipped,
+   ie PA8 on the STM32F103, and read as 0 like analogRead() does.
+   Once started do not use analogRead() on the scanned pins as it
+   would reconfigure ADC1.
+*/
+boolean adcDmaBegin(const int *pins, uint8_t nbrPins)
+{
+  ADC_ChannelConfTypeDef channelConf = {};
+  RCC_PeriphCLKInitTypeDef clockConf = {};
+  uint32_t channels[ADC_DMA_MAX_CHANNELS];
+
+  adcDmaRunning = false;
+  adcNbrChannels = 0;
+  for (uint8_t i = 0; i < nbrPins && adcNbrChannels < ADC_DMA_MAX_CHANNELS; i++) {
+    PinName pinName = digitalPinToPinName(pins[i]);
+    uint32_t function = pinmap_function(pinName, PinMap_ADC);
+    if (function == (uint32_t)NC)
+      continue;
+    pinMode(pins[i], INPUT_ANALOG);
+    adcPins[adcNbrChannels] = pins[i];
+    // on the F1 ADC_CHANNEL_x is x
+    channels[adcNbrChannels] = STM_PIN_CHANNEL(function);
+    adcNbrChannels++;
+  }
+  if (adcNbrChannels == 0)
+    return false;
+
+  // 72MHz / 6 = 12MHz, the ADC clock must stay below 14MHz
+  clockConf.PeriphClockSelection = RCC_PERIPHCLK_ADC;
+  clockConf.AdcClockSelection = RCC_ADCPCLK2_DIV6;
+  HAL_RCCEx_PeriphCLKConfig(&clockConf);
+  __HAL_RCC_ADC1_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  adcHandle.Instance = ADC1;
+  adcHandle.Init.ScanConvMode = ADC_SCAN_ENABLE;
+  adcHandle.Init.ContinuousConvMode = ENABLE;
+  adcHandle.Init.DiscontinuousConvMode = DISABLE;
+  adcHandle.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+  adcHandle.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+  adcHandle.Init.NbrOfConversion = adcNbrChannels;
+  if (HAL_ADC_Init(&adcHandle) != HAL_OK)
+    return false;
+
+  for (uint8_t i = 0; i < adcNbrChannels; i++) {
+    channelConf.Channel = channels[i];
+    channelConf.Rank = ADC_REGULAR_RANK_1 + i;
+    // (239.5 + 12.5) / 12MHz = 21us per conversion
+    channelConf.SamplingTime = ADC_SAMPLETIME_239CYCLES_5;
+    if (HAL_ADC_ConfigChannel(&adcHandle, &channelConf) != HAL_OK)
+      return false;
+  }
+
+  adcDmaHandle.Instance = DMA1_Channel1;
+  adcDmaHandle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  adcDmaHandle.Init.PeriphInc = DMA_PINC_DISABLE;
+  adcDmaHandle.Init.MemInc = DMA_MINC_ENABLE;
+  adcDmaHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  adcDmaHandle.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  adcDmaHandle.Init.Mode = DMA_CIRCULAR;
+  adcDmaHandle.Init.Priority = DMA_PRIORITY_MEDIUM;
+  if (HAL_DMA_Init(&adcDmaHandle) != HAL_OK)
+    return false;
+  __HAL_LINKDMA(&adcHandle, DMA_Handle, adcDmaHandle);
+
+  HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 6, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+
+  HAL_ADCEx_Calibration_Start(&adcHandle);
+  adcReadyHalf = 2;
+  adcDmaRunning = HAL_ADC_Start_DMA(&adcHandle, (uint32_t *)adcBuffer, 2 * ADC_DMA_SCANS * adcNbrChannels) == HAL_OK;
+  return adcDmaRunning;
+}
+
+/*
+   adcAnalogRead()
+   same average as adcDmaRead() when the DMA does not run
+*/
+static long adcAnalogRead(int pin)
+{
+  unsigned long sum = 0;
+  for (uint8_t i = 0; i < ADC_DMA_SCANS; i++)
+    sum += analogRead(pin);
+  return (long)(sum * 16 / ADC_DMA_SCANS);
+}
+
+/*
+   adcDmaRead()
+   Average of the pin over the latest completed half buffer,
+   in 1/16 of an ADC count
+*/
+long adcDmaRead(int pin)
+{
+  if (!adcDmaRunning)
+    return adcAnalogRead(pin);
+
+  uint8_t channel;
+  for (channel = 0; channel < adcNbrChannels; channel++) {
+    if (adcPins[channel] == pin)
+      break;
+  }
+  if (channel == adcNbrChannels)
+    return 0;
+
+  // only right after adcDmaBegin(), the first half takes 2ms
+  unsigned long start = millis();
+  while (adcReadyHalf > 1) {
+    if (millis() - start > ADC_DMA_TIMEOUT) {
+      // the DMA is stuck, free ADC1 for analogRead()
+      HAL_ADC_Stop_DMA(&adcHandle);
+      adcDmaRunning = false;
+      return adcAnalogRead(pin);
+    }
+    yield();
+  }
+
+  const volatile uint16_t *half = adcBuffer + adcReadyHalf * ADC_DMA_SCANS * adcNbrChannels;
+  unsigned long sum = 0;
+  for (uint8_t i = 0; i < ADC_DMA_SCANS; i++)
+    sum += half[i * adcNbrChannels + channel];
+  return (long)(sum * 16 / ADC_DMA_SCANS);
+}
+#endif
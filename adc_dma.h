@@ -0,0 +1,25 @@
+#ifndef _ADC_DMA_H
+#define _ADC_DMA_H
+/*
+   Continuous ADC sampling for the STM32 boards
+
+   ADC1 scans the analog inputs over and over and the DMA copies the
+   conversions into a circular buffer. Reading a channel averages the
+   latest completed half of the buffer, so it does not wait for any
+   conversion. If the DMA could not be started, or gives no half in
+   ADC_DMA_TIMEOUT ms, the pins are read with analogRead() instead.
+*/
+#include "config.h"
+#include "Arduino.h"
+
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+#define ADC_DMA_MAX_CHANNELS 3
+// scans per half buffer, one scan of 3 channels takes 63us
+#define ADC_DMA_SCANS 32
+// a half takes 2ms
+#define ADC_DMA_TIMEOUT 5
+
+extern boolean adcDmaBegin(const int *pins, uint8_t nbrPins);
+extern long adcDmaRead(int pin);
+#endif
+#endif
@@ -0,0 +1,66 @@
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+/*
+   The part of the Arduino core the logger uses, to build it on a
+   computer against a FileStorage. The serial ports print to stdout.
+*/
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define F(x) (x)
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+int analogRead(uint8_t pin);
+void pinMode(uint8_t pin, uint8_t mode);
+
+class Print
+{
+  public:
+    size_t print(const char *s);
+    size_t print(char c);
+    size_t print(int n);
+    size_t print(long n);
+    size_t print(unsigned int n);
+    size_t print(unsigned long n);
+    size_t print(double n, int digits = 2);
+    size_t println(const char *s = "");
+    size_t println(char c);
+    size_t println(int n);
+    size_t println(long n);
+    size_t println(unsigned int n);
+    size_t println(unsigned long n);
+    size_t println(double n, int digits = 2);
+};
+
+class Stream : public Print
+{
+  public:
+    int available() { return 0; }
+    int read() { return -1; }
+};
+
+class HardwareSerial : public Stream
+{
+  public:
+    void begin(unsigned long) {}
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef _HOST_BLUETOOTHSERIAL_H
+#define _HOST_BLUETOOTHSERIAL_H
+#include "Arduino.h"
+
+class BluetoothSerial : public Stream
+{
+  public:
+    bool begin(const char *) { return true; }
+};
+
+#endif
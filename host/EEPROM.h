@@ -0,0 +1,22 @@
+#ifndef _HOST_EEPROM_H
+#define _HOST_EEPROM_H
+/*
+   The internal eeprom of the microcontroller, in RAM
+*/
+#include "Arduino.h"
+
+class EEPROMClass
+{
+  public:
+    void begin(size_t) {}
+    void end() {}
+    bool commit() { return true; }
+    uint8_t read(int address) { return _data[address]; }
+    void write(int address, uint8_t value) { _data[address] = value; }
+  private:
+    uint8_t _data[1024];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _HOST_WIRE_H
+#define _HOST_WIRE_H
+/*
+   No I2C bus on a computer, every device is absent
+*/
+#include "Arduino.h"
+
+// as the cores: the ESP32 one has I2C_BUFFER_LENGTH, config.h makes
+// BUFFER_LENGTH of it, the others have BUFFER_LENGTH
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+#define I2C_BUFFER_LENGTH 128
+#else
+#define BUFFER_LENGTH 32
+#endif
+
+class TwoWire
+{
+  public:
+    void begin() {}
+    void beginTransmission(uint8_t) {}
+    size_t write(uint8_t) { return 1; }
+    size_t write(const uint8_t *, size_t n) { return n; }
+    // 2, the address was not acknowledged
+    uint8_t endTransmission(bool = true) { return 2; }
+    uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+    int read() { return -1; }
+};
+
+extern TwoWire Wire;
+
+#endif
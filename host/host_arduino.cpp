@@ -0,0 +1,65 @@
+#include "config.h"
+#include <Wire.h>
+#include <EEPROM.h>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+BluetoothSerial SerialBT;
+#endif
+TwoWire Wire;
+EEPROMClass EEPROM;
+
+static std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+           std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned long micros()
+{
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now() - start).count();
+}
+
+void delay(unsigned long ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield()
+{
+}
+
+int analogRead(uint8_t pin)
+{
+  return 0;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+size_t Print::print(const char *s) { return fputs(s, stdout) < 0 ? 0 : strlen(s); }
+size_t Print::print(char c) { return putchar(c) < 0 ? 0 : 1; }
+size_t Print::print(int n) { return printf("%d", n); }
+size_t Print::print(long n) { return printf("%ld", n); }
+size_t Print::print(unsigned int n) { return printf("%u", n); }
+size_t Print::print(unsigned long n) { return printf("%lu", n); }
+size_t Print::print(double n, int digits) { return printf("%.*f", digits, n); }
+size_t Print::println(const char *s) { return print(s) + print('\n'); }
+size_t Print::println(char c) { return print(c) + print('\n'); }
+size_t Print::println(int n) { return print(n) + print('\n'); }
+size_t Print::println(long n) { return print(n) + print('\n'); }
+size_t Print::println(unsigned int n) { return print(n) + print('\n'); }
+size_t Print::println(unsigned long n) { return print(n) + print('\n'); }
+size_t Print::println(double n, int digits) { return print(n, digits) + print('\n'); }
@@ -0,0 +1 @@
+// itoa() and ltoa() of the STM32 core, the logger does not use them
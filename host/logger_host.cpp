@@ -0,0 +1,156 @@
+/*
+   logger_host
+   Records curves with the logger into a FileStorage and reads them back
+   with a second logger on the same file, as after a power cycle. Once as
+   an eeprom, once as a flash with 4 KB erase blocks and once as a slow
+   memory on a simulated clock.
+   usage: logger_host <directory of the memory files>
+   Returns the number of failed checks.
+*/
+#include <cstdio>
+#include <string>
+#include "logger_i2c_eeprom.h"
+#include "storage_file.h"
+
+#define HOST_CAPACITY 65536UL
+#define HOST_RECORDS 400
+#define HOST_TRIGGER 10
+#define HOST_STOP (HOST_RECORDS - 20)
+
+static int failures = 0;
+
+static void check(bool ok, const char *memory, const char *what, long value)
+{
+  if (ok)
+    return;
+  std::printf("%s: %s failed (%ld)\n", memory, what, value);
+  failures++;
+}
+
+// each reading moves the clock by 1 ms, the slow writes then wait without
+// sleeping
+static unsigned long fakeTime = 0;
+static unsigned long fakeClock()
+{
+  return fakeTime++;
+}
+
+// thrust of record i of a curve, a ramp up and down so that the compact
+// records carry differences of both signs
+static long hostThrust(long base, long i)
+{
+  return base + (i < HOST_RECORDS / 2 ? i * 37 : (HOST_RECORDS - i) * 37);
+}
+
+static void recordCurve(logger_I2C_eeprom &logger, int format, long base)
+{
+  logger.readThrustCurveList();
+  int nbr = logger.getLastThrustCurveNbr() + 1;
+  unsigned long address = logger.getNextCurveStart();
+
+  logger.setThrustCurveStartAddress(nbr, address);
+  logger.setThrustCurveFormat(nbr, format);
+  address = logger.writeThrustCurveHeader(nbr, address, THRUSTCURVE_CH_ALL, 1000, 0, 1000, 0, 0);
+  for (long i = 0; i < HOST_RECORDS; i++)
+  {
+    logger.setThrustCurveTimeData(i);
+    logger.setThrustCurveData(hostThrust(base, i));
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    logger.setPressureCurveData(i % 50);
+#endif
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    logger.setPressureCurveData2(-(i % 30));
+    logger.setThrustCurveDataFiltered(hostThrust(base, i) / 2);
+#endif
+#if NBR_LOADCELLS > 1
+    for (int c = 1; c < NBR_LOADCELLS; c++)
+      logger.setThrustCurveDataChannel(c, hostThrust(base, i) + c);
+#endif
+    address = logger.writeFastThrustCurve(address);
+    logger.poll();
+  }
+  logger.flushThrustCurve();
+  logger.setThrustCurveEndAddress(nbr, address - 1);
+  logger.setThrustCurveMarks(HOST_TRIGGER, HOST_STOP);
+  logger.writeThrustCurveList();
+}
+
+static void checkCurve(logger_I2C_eeprom &logger, const char *memory, int nbr, int format, long base)
+{
+  long triggerRecord, stopRecord;
+  int stored = logger.getThrustCurveFormat(nbr);
+  unsigned long address = logger.readThrustCurveHeader(logger.getThrustCurveStart(nbr));
+
+  check((stored & THRUSTCURVE_FORMAT_MASK) == format, memory, "format", stored);
+  check((stored & THRUSTCURVE_FORMAT_HEADER) != 0, memory, "header", stored);
+  for (long i = 0; i < HOST_RECORDS; i++)
+  {
+    if (format == THRUSTCURVE_FORMAT_COMPACT)
+      address = logger.readCompactThrustCurve(address);
+    else
+      address = logger.readPackedThrustCurve(address);
+    if (logger.getThrustCurveData() != hostThrust(base, i))
+    {
+      check(false, memory, "thrust of record", i);
+      return;
+    }
+    check(logger.getThrustCurveTimeData() == i, memory, "time of record", i);
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    check(logger.getPressureCurveData() == i % 50, memory, "pressure of record", i);
+#endif
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    check(logger.getPressureCurveData2() == -(i % 30), memory, "pressure2 of record", i);
+#endif
+  }
+  check((long)address == logger.getThrustCurveStop(nbr) + 1, memory, "end of curve", address);
+  logger.getThrustCurveMarks(nbr, triggerRecord, stopRecord);
+  check(triggerRecord == HOST_TRIGGER, memory, "trigger mark", triggerRecord);
+  check(stopRecord == HOST_STOP, memory, "stop mark", stopRecord);
+}
+
+static void runMemory(const std::string &dir, const char *memory, unsigned long eraseSize,
+                      unsigned long writeBytesPerMs, FileStorageClock clock)
+{
+  std::string path = dir + "/" + memory + ".bin";
+  std::remove(path.c_str());
+
+  {
+    FileStorage file(path.c_str(), HOST_CAPACITY, eraseSize, writeBytesPerMs, clock);
+    logger_I2C_eeprom logger(0);
+    logger.setStorage(file);
+    check(logger.begin() == 0, memory, "begin", 0);
+    check(logger.probeCapacity(HOST_CAPACITY) == HOST_CAPACITY, memory, "capacity", logger.getCapacity());
+    logger.clearThrustCurveList();
+    logger.readThrustCurveList();
+    check(logger.CanRecord(), memory, "can record", 0);
+    recordCurve(logger, THRUSTCURVE_FORMAT_RAW, 1000);
+    recordCurve(logger, THRUSTCURVE_FORMAT_COMPACT, -5000);
+    recordCurve(logger, THRUSTCURVE_FORMAT_COMPACT, 70000);
+    check(logger.eraseLastThrustCurve(), memory, "erase", 0);
+  }
+
+  // the power comes back, a new logger reads the same file
+  FileStorage file(path.c_str(), HOST_CAPACITY, eraseSize, writeBytesPerMs, clock);
+  logger_I2C_eeprom logger(0);
+  logger.setStorage(file);
+  check(logger.begin() == 0, memory, "begin again", 0);
+  logger.probeCapacity(HOST_CAPACITY);
+  check(logger.readThrustCurveList() == 2, memory, "curves", logger.getLastThrustCurveNbr() + 1);
+  checkCurve(logger, memory, 0, THRUSTCURVE_FORMAT_RAW, 1000);
+  checkCurve(logger, memory, 1, THRUSTCURVE_FORMAT_COMPACT, -5000);
+  if (eraseSize > 1)
+    check(logger.getThrustCurveStart(1) % eraseSize == 0, memory, "curve on an erase block", logger.getThrustCurveStart(1));
+  std::printf("%s: 2 curves, %ld bytes\n", memory, logger.getLastThrustCurveEndAddress());
+}
+
+int main(int argc, char *argv[])
+{
+  std::string dir = argc > 1 ? argv[1] : ".";
+
+  runMemory(dir, "eeprom", 1, 0, NULL);
+  runMemory(dir, "flash", 4096, 0, NULL);
+  runMemory(dir, "slow", 1, 32, fakeClock);
+  if (failures == 0)
+    std::printf("ok\n");
+  return failures;
+}
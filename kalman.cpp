@@ -1,59 +1,84 @@
-#include "kalman.h"
-
-//Kalman Variables
- float f_1=1.00000;  //cast as float
- float kalman_x;
- float kalman_x_last;
- float kalman_p;
- float kalman_p_last;
- float kalman_k;
- float kalman_q;
- float kalman_r;
- float kalman_x_temp;
- float kalman_p_temp;
-//end of Kalman Variables
-//================================================================
-// Kalman functions in your code
-//================================================================
-
-//Call KalmanInit() once.  
-
-//KalmanInit() - Call before any iterations of KalmanCalc()
-void KalmanInit()
-{
-
-  kalman_q=4.0001;  //filter parameters, you can play around with them
-  kalman_r=.20001;  // but these values appear to be fairly optimal
-
-  kalman_x = 0;
-  kalman_p = 0;
-  kalman_x_temp = 0;
-  kalman_p_temp = 0;
-
-  kalman_x_last = 0;
-  kalman_p_last = 0;
-
-}
-
-//KalmanCalc() - Calculates new Kalman values from float value "pressure"
-// This will be the ASL pressure during the thrust, and the AGL pressure during dumps
-float KalmanCalc (float pressure)
-{
-
-  //Predict kalman_x_temp, kalman_p_temp
-  kalman_x_temp = kalman_x_last;
-  kalman_p_temp = kalman_p_last + kalman_r;
-
-  //Update kalman values
-  kalman_k = (f_1/(kalman_p_temp + kalman_q)) * kalman_p_temp;
-  kalman_x = kalman_x_temp + (kalman_k * (pressure - kalman_x_temp));
-  kalman_p = (f_1 - kalman_k) * kalman_p_temp;
-
-  //Save this state for next time
-  kalman_x_last = kalman_x;
-  kalman_p_last = kalman_p;
-
-  //Assign current Kalman filtered altitude to working variables
-  //KAlt = kalman_x; //FLOAT Kalman-filtered altitude value
-  return kalman_x;
-}  
+#include "kalman.h"
+
+//================================================================
+// Kalman functions in your code
+//================================================================
+
+KalmanFilter::KalmanFilter(float q, float r)
+{
+  init(q, r);
+}
+
+void KalmanFilter::init(float q, float r)
+{
+  _q = q;
+  _r = r;
+  // the prediction variance settles where p = (p * q) / (p + q) + r
+  // ie p = (r + sqrt(r * r + 4 * r * q)) / 2
+  float p = (_r + sqrt(_r * _r + 4 * _r * _q)) / 2;
+  _steadyK = p / (p + _q);
+  reset();
+}
+
+void KalmanFilter::reset()
+{
+  _x = 0;
+  _p = 0;
+  _k = 0;
+  _steady = false;
+}
+
+//update() - Calculates new Kalman values from float value "value"
+float KalmanFilter::update(float value)
+{
+  if (_steady) {
+    _x += _steadyK * (value - _x);
+    return _x;
+  }
+
+  //Predict
+  float p_temp = _p + _r;
+
+  //Update kalman values
+  _k = p_temp / (p_temp + _q);
+  _x = _x + (_k * (value - _x));
+  _p = (1.0 - _k) * p_temp;
+
+  //from now on the gain would not move any more
+  if (fabs(_k - _steadyK) < 1e-5 * _steadyK) {
+    _k = _steadyK;
+    _steady = true;
+  }
+  return _x;
+}
+
+KalmanFilterFixed::KalmanFilterFixed(float q, float r)
+{
+  init(q, r);
+}
+
+void KalmanFilterFixed::init(float q, float r)
+{
+  // same steady state gain as KalmanFilter
+  float p = (r + sqrt(r * r + 4 * r * q)) / 2;
+  _k = (uint16_t)(65536.0 * p / (p + q) + 0.5);
+  reset();
+}
+
+void KalmanFilterFixed::reset()
+{
+  _x = 0;
+  _started = false;
+}
+
+//update() - value and result in 1/16 of a unit
+long KalmanFilterFixed::update(long value)
+{
+  if (!_started) {
+    _x = value;
+    _started = true;
+    return _x;
+  }
+  _x += (long)(((int64_t)_k * (value - _x)) >> 16);
+  return _x;
+}
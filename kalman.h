@@ -1,18 +1,57 @@
-#ifndef _KALMAN_H
-#define _KALMAN_H
-//Kalman Variables
-extern float f_1;//=1.00000;  //cast as float
-extern float kalman_x;
-extern float kalman_x_last;
-extern float kalman_p;
-extern float kalman_p_last;
-extern float kalman_k;
-extern float kalman_q;
-extern float kalman_r;
-extern float kalman_x_temp;
-extern float kalman_p_temp;
-//end of Kalman Variables
-
-extern void KalmanInit();
-extern float KalmanCalc (float pressure);
-#endif
+#ifndef _KALMAN_H
+#define _KALMAN_H
+#include "Arduino.h"
+
+//filter parameters, you can play around with them
+//but these values appear to be fairly optimal
+#define KALMAN_Q 4.0001
+#define KALMAN_R .20001
+
+/*
+   One dimension Kalman filter, use one per channel.
+   As q and r never change the gain converges to a fixed value,
+   once it has the update is a single multiply-add.
+*/
+class KalmanFilter
+{
+  public:
+    KalmanFilter(float q = KALMAN_Q, float r = KALMAN_R);
+    //Call before any iterations of update()
+    void init(float q, float r);
+    void reset();
+    float update(float value);
+    float get() { return _x; };
+    float getGain() { return _k; };
+    bool isSteady() { return _steady; };
+
+  private:
+    float _q;
+    float _r;
+    float _x;
+    float _p;
+    float _k;
+    float _steadyK;
+    bool _steady;
+};
+
+/*
+   Integer version for the boards without FPU.
+   It runs at the steady state gain from the first update, values
+   are in 1/16 of a unit.
+*/
+class KalmanFilterFixed
+{
+  public:
+    KalmanFilterFixed(float q = KALMAN_Q, float r = KALMAN_R);
+    void init(float q, float r);
+    void reset();
+    long update(long value);
+    long get() { return _x; };
+
+  private:
+    long _x;
+    // gain in 1/65536
+    uint16_t _k;
+    bool _started;
+};
+#endif
@@ -1,398 +1,1507 @@
-#include "logger_i2c_eeprom.h"
-#include "IC2extEEPROM.h"
-extEEPROM eep(kbits_512, 1, 64);
-
-logger_I2C_eeprom::logger_I2C_eeprom(uint8_t deviceAddress)
-{
-}
-
-void logger_I2C_eeprom::begin()
-{
-  Wire.begin();
-}
-
-/*
-   clearThrustCurveList()
-   Clear the Thrust Curve list. Rather than clearing the entire eeprom
-   let's just reset addresses 0 to 200 which contains the Thrust Curve addresses
-
-*/
-void logger_I2C_eeprom::clearThrustCurveList()
-{
-  int i;
-  for (i = 0; i < 25; i++)
-  {
-    _ThrustCurveConfig[i].ThrustCurve_start = 0;
-    _ThrustCurveConfig[i].ThrustCurve_stop = 0;
-  }
-}
-
-
-/*
-   readThrustCurveList()
-
-*/
-int logger_I2C_eeprom::readThrustCurveList()
-{
-  eep.read(0, ((byte*)&_ThrustCurveConfig), sizeof(_ThrustCurveConfig));
-  return THRUSTCURVE_LIST_START + sizeof(_ThrustCurveConfig) ;
-}
-/*
-   readThrustCurve(int eeaddress)
-
-*/
-unsigned long logger_I2C_eeprom::readThrustCurve(unsigned long eeaddress)
-{
-  eep.read(eeaddress, ((byte*)&_ThrustCurveData), sizeof(_ThrustCurveData));
-  return eeaddress + sizeof(_ThrustCurveData);
-}
-
-/*
-   writeThrustCurveList()
-
-*/
-int logger_I2C_eeprom::writeThrustCurveList()
-{
-  eep.write(THRUSTCURVE_LIST_START, ((byte*)&_ThrustCurveConfig), sizeof(_ThrustCurveConfig));
-  return THRUSTCURVE_LIST_START + sizeof(_ThrustCurveConfig);
-}
-
-/*
-   writeFastThrustCurve(int eeaddress)
-
-*/
-unsigned long logger_I2C_eeprom::writeFastThrustCurve(unsigned long eeaddress)
-{
-  eep.write(eeaddress, ((byte*)&_ThrustCurveData), sizeof(_ThrustCurveData));
-  return eeaddress + sizeof(_ThrustCurveData);
-}
-
-/*
-
-   getLastThrustCurveNbr()
-   Parse the Thrust curves index end check if the ThrustCurve_start address is > 0
-   return -1 if no thrust curves have been recorded else return the thrust curve number
-
-*/
-int logger_I2C_eeprom::getLastThrustCurveNbr()
-{
-  int i;
-  for (i = 0; i < 25; i++)
-  {
-    if (_ThrustCurveConfig[i].ThrustCurve_start == 0)
-    {
-      break;
-    }
-  }
-  i--;
-  return i;
-}
-
-/*
-
-  eraseLastThrustCurve()
-
-*/
-bool logger_I2C_eeprom::eraseLastThrustCurve() {
-  int i;
-  for (i = 0; i < 25; i++)
-  {
-    if (_ThrustCurveConfig[i].ThrustCurve_start == 0)
-    {
-      if (i > 0) {
-        _ThrustCurveConfig[i - 1].ThrustCurve_start = 0;
-        _ThrustCurveConfig[i - 1].ThrustCurve_stop = 0;
-        writeThrustCurveList();
-        return true;
-      }
-    }
-  }
-  return false;
-}
-
-/*
-
-   getLastThrustCurveEndAddress()
-   Parse the ThrustCurve index end check if the ThrustCurve_start address is > 0
-   return -1 if no ThrustCurve have been recorded else return the ThrustCurve number
-
-*/
-long logger_I2C_eeprom::getLastThrustCurveEndAddress()
-{
-  int i;
-  for (i = 0; i < 25; i++)
-  {
-    if (_ThrustCurveConfig[i].ThrustCurve_start == 0)
-    {
-      break;
-    }
-  }
-  i--;
-  return _ThrustCurveConfig[i].ThrustCurve_stop;
-}
-
-/*
-
-   printThrustCurveList()
-
-
-*/
-int logger_I2C_eeprom::printThrustCurveList()
-{
-  //retrieve from the eeprom
-  int v_ret =  readThrustCurveList();
-
-  //Read the stucture
-  int i;
-  for (i = 0; i < 25; i++)
-  {
-    if (_ThrustCurveConfig[i].ThrustCurve_start == 0)
-      break;
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-    Serial.print("ThrustCurve Nbr: ");
-    Serial.println(i);
-    Serial.print("Start: ");
-    Serial.println(_ThrustCurveConfig[i].ThrustCurve_start);
-    Serial.print("End: ");
-    Serial.println(_ThrustCurveConfig[i].ThrustCurve_stop);
-#endif
-    SerialCom.print("ThrustCurve Nbr: ");
-    SerialCom.println(i);
-    SerialCom.print("Start: ");
-    SerialCom.println(_ThrustCurveConfig[i].ThrustCurve_start);
-    SerialCom.print("End: ");
-    SerialCom.println(_ThrustCurveConfig[i].ThrustCurve_stop);
-  }
-  return i;
-}
-
-void logger_I2C_eeprom::setThrustCurveStartAddress(int ThrustCurveNbr, long startAddress)
-{
-  _ThrustCurveConfig[ThrustCurveNbr].ThrustCurve_start = startAddress;
-}
-
-void logger_I2C_eeprom::setThrustCurveEndAddress(int ThrustCurveNbr, long endAddress)
-{
-  _ThrustCurveConfig[ThrustCurveNbr].ThrustCurve_stop = endAddress;
-}
-
-void logger_I2C_eeprom::setThrustCurveTimeData( long difftime)
-{
-  _ThrustCurveData.diffTime = difftime;
-}
-void logger_I2C_eeprom::setThrustCurveData( long thrust)
-{
-  _ThrustCurveData.thrust = thrust;
-}
-
-long logger_I2C_eeprom::getThrustCurveStart(int ThrustCurveNbr)
-{
-  return  _ThrustCurveConfig[ThrustCurveNbr].ThrustCurve_start;
-}
-long logger_I2C_eeprom::getThrustCurveStop(int ThrustCurveNbr)
-{
-  return  _ThrustCurveConfig[ThrustCurveNbr].ThrustCurve_stop;
-}
-long logger_I2C_eeprom::getThrustCurveTimeData()
-{
-  return _ThrustCurveData.diffTime;
-}
-long logger_I2C_eeprom::getThrustCurveData()
-{
-  return _ThrustCurveData.thrust;
-}
-#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-long logger_I2C_eeprom::getPressureCurveData()
-{
-  return _ThrustCurveData.casing_pressure;
-}
-void logger_I2C_eeprom::setPressureCurveData( long pressure)
-{
-  _ThrustCurveData.casing_pressure = pressure;
-}
-#endif
-
-#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-long logger_I2C_eeprom::getPressureCurveData2()
-{
-  return _ThrustCurveData.casing_pressure2;
-}
-void logger_I2C_eeprom::setPressureCurveData2( long pressure)
-{
-  _ThrustCurveData.casing_pressure2 = pressure;
-}
-long logger_I2C_eeprom::getThrustCurveDataFiltered()
-{
-  return _ThrustCurveData.thrust_filtered;
-}
-void logger_I2C_eeprom::setThrustCurveDataFiltered( long thrust)
-{
-  _ThrustCurveData.thrust_filtered = thrust;
-}
-#endif
-
-long logger_I2C_eeprom::getSizeOfThrustCurveData()
-{
-  return sizeof(_ThrustCurveData);
-}
-
-void logger_I2C_eeprom::printThrustCurveData(int ThrustCurveNbr)
-{
-  unsigned long startaddress;
-  unsigned long endaddress;
-
-  startaddress = getThrustCurveStart(ThrustCurveNbr);
-  endaddress = getThrustCurveStop(ThrustCurveNbr);
-
-  if (startaddress > 200)
-  {
-    unsigned long i = startaddress;
-    unsigned long currentTime = 0;
-
-    while (i < (endaddress + 1))
-    {
-      i = readThrustCurve(i) + 1;
-      char ThrustCurveData[120] = "";
-      char temp[20] = "";
-      currentTime = currentTime + getThrustCurveTimeData();
-      strcat(ThrustCurveData, "data,");
-      sprintf(temp, "%i,", ThrustCurveNbr );
-      strcat(ThrustCurveData, temp);
-      sprintf(temp, "%i,", (int) currentTime );
-      //sprintf(temp, "%lu,", currentTime );
-      strcat(ThrustCurveData, temp);
-      sprintf(temp, "%i,", (int)getThrustCurveData() );
-      strcat(ThrustCurveData, temp);
-#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-      sprintf(temp, "%i,", (int)getPressureCurveData() );
-      strcat(ThrustCurveData, temp);
-#endif
-#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-      sprintf(temp, "%i,", (int)getPressureCurveData2() );
-      strcat(ThrustCurveData, temp);
-      sprintf(temp, "%i,", (int)getThrustCurveDataFiltered() );
-      strcat(ThrustCurveData, temp);
-#endif
-      unsigned int chk = msgChk(ThrustCurveData, sizeof(ThrustCurveData));
-      sprintf(temp, "%i", chk);
-      strcat(ThrustCurveData, temp);
-      strcat(ThrustCurveData, ";\n");
-#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
-      Serial.print("$");
-      Serial.print(ThrustCurveData);
-#endif
-      SerialCom.print("$");
-      SerialCom.print(ThrustCurveData);
-
-      //This will slow down the data
-      // this is for telemetry modules without enought buffer
-      if (config.telemetryType == 0)
-        delay(0);
-      else if (config.telemetryType == 1)
-        delay(20);
-      else if (config.telemetryType == 2)
-        delay(50);
-      else if (config.telemetryType == 3)
-        delay(100);
-    }
-  }
-}
-/*
-   CanRecord()
-   First count the number of Thrust Curves. It cannot be greater than 25
-   if last Thrust Curve end address is greater than the max possible
-   address then the EEprom is full
-*/
-boolean logger_I2C_eeprom::CanRecord()
-{
-  long lastThrustCurve;
-  lastThrustCurve = getLastThrustCurveNbr();
-  if (lastThrustCurve == -1)
-    return true;
-
-  if (lastThrustCurve == 24)
-  {
-    return false;
-  }
-  // Check if eeprom is full
-  if (getThrustCurveStop(lastThrustCurve) > 65500 )
-  {
-    return false;
-  }
-  return true;
-}
-
-// this is to check your eeprom byte by byte. This will take approx 11 minutes for a 512 eeprom
-long logger_I2C_eeprom::checkMemoryErrors(long memoryLastAddress) {
-  long errors = 0;
-  for (long i = 0; i < memoryLastAddress; i++)
-  {
-    //read byte and save it
-    byte currentByte;
-    eep.read(i, ((byte*)&currentByte), sizeof(byte));
-
-    //write byte
-    byte bToWrite = ~currentByte;
-    eep.write(i, ((byte*)&bToWrite), sizeof(currentByte));
-    delay(5);
-    //check if value is the same
-    byte myByte;
-    eep.read(i, ((byte*)&myByte), sizeof(byte));
-    // if not the same add an error
-    if (myByte != bToWrite)
-      errors++;
-
-    //restore previous value
-    eep.write(i, ((byte*)&currentByte), sizeof(currentByte));
-    delay(5);
-  }
-  return errors;
-}
-
-// this will check the memory size
-int logger_I2C_eeprom::checkMemorySize() {
-  int memSize = 0;
-
-  // check for 4093 = 32K
-  if (checkWrite(4093))
-    memSize = 32;
-  // check for 8187 = 64 K
-  if (checkWrite(8187))
-    memSize = 64;
-  // check for 16375 = 128k
-  if (checkWrite(16375))
-    memSize = 128;
-  // check for 32750 = 256K
-  if (checkWrite(32750))
-    memSize = 256;
-  // check for 65500=512K
-  if (checkWrite(65500))
-    memSize = 512;
-  return memSize;
-}
-
-bool logger_I2C_eeprom::checkWrite(long address) {
-  bool ok = false;
-  //read byte and save it
-  byte currentByte;
-  eep.read(address, ((byte*)&currentByte), sizeof(byte));
-  SerialCom.print("currentByte:");
-  SerialCom.println(currentByte);
-  //write byte
-  byte bToWrite = ~currentByte;
-  eep.write(address, ((byte*)&bToWrite), sizeof(currentByte));
-  SerialCom.print("bToWrite:");
-  SerialCom.println(bToWrite);
-  delay(5);
-  //check if value is the same
-  byte myByte;
-  eep.read(address, ((byte*)&myByte), sizeof(byte));
-  SerialCom.print("myByte:");
-  SerialCom.println(myByte);
-  if (myByte == bToWrite)
-    ok = true;
-  //restore previous value
-  eep.write(address, ((byte*)&currentByte), sizeof(currentByte));
-  delay(5);
-  return ok;
-}
+#include "logger_i2c_eeprom.h"
+#include "IC2extEEPROM.h"
+#include <stddef.h>
+#if defined STORAGE_ESP32_FLASH && (defined TESTSTANDESP32 || defined TESTSTANDESP32V3)
+#include "storage_esp32.h"
+ESP32FlashStorage storage(ESP32_FLASH_PARTITION);
+#elif defined STORAGE_SPI_NOR
+#include "storage_spi.h"
+SPINorStorage storage(STORAGE_SPI_CS);
+#elif defined STORAGE_SPI_FRAM
+#include "storage_spi.h"
+SPIFramStorage storage(STORAGE_SPI_CS, STORAGE_SPI_FRAM_SIZE);
+#else
+extEEPROM storage(kbits_512, 1, LOGGER_EEPROM_CHIP_PAGESIZE);
+#endif
+
+logger_I2C_eeprom::logger_I2C_eeprom(uint8_t deviceAddress)
+{
+  _storage = &storage;
+  _stage = _stageBuffer[0];
+  _stagePage = 0;
+  _stageFrom = 0;
+  _stageTo = 0;
+  _writePending = false;
+  _writeErrors = 0;
+  _writeFormat = THRUSTCURVE_FORMAT_RAW;
+  _readFormat = THRUSTCURVE_FORMAT_RAW;
+  _readBlockValid = false;
+  _storageStatus = 0;
+  _capacity = 65536;
+  _curveBase = 0;
+  _curveCount = 0;
+  _lastEnd = THRUSTCURVE_DATA_START;
+  _logSlots = 1;
+  _generation = 0;
+  _curveOpen = false;
+  _openSlot = 0;
+  _writeCount = 0;
+  _openTrigger = -1;
+  _openStop = -1;
+  _checkpointSlot = 0;
+  _erasedTo = 0;
+  _eraseAhead = 0;
+  _compactCount = 0;
+  _readCount = 0;
+  setFields(THRUSTCURVE_CH_ALL);
+}
+
+/*
+   channelField()
+   index in ThrustCurveDataStruct, seen as an array of long, of the field
+   of a channel. -1 if this board does not have it
+*/
+static int8_t channelField(uint8_t channel)
+{
+  switch (channel)
+  {
+    case THRUSTCURVE_CH_TIME:
+      return offsetof(ThrustCurveDataStruct, diffTime) / sizeof(long);
+    case THRUSTCURVE_CH_THRUST:
+      return offsetof(ThrustCurveDataStruct, thrust) / sizeof(long);
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    case THRUSTCURVE_CH_PRESSURE:
+      return offsetof(ThrustCurveDataStruct, casing_pressure) / sizeof(long);
+#endif
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    case THRUSTCURVE_CH_PRESSURE2:
+      return offsetof(ThrustCurveDataStruct, casing_pressure2) / sizeof(long);
+    case THRUSTCURVE_CH_THRUST_FILTERED:
+      return offsetof(ThrustCurveDataStruct, thrust_filtered) / sizeof(long);
+#endif
+  }
+#if NBR_LOADCELLS > 1
+  for (uint8_t i = 0; i < NBR_LOADCELLS - 1; i++)
+  {
+    if (channel == (THRUSTCURVE_CH_LOADCELL2 << i))
+      return offsetof(ThrustCurveDataStruct, thrust_channel) / sizeof(long) + i;
+  }
+#endif
+  return -1;
+}
+
+/*
+   setFields()
+   pick the record fields of the channels this board has,
+   returns these channels
+*/
+uint8_t logger_I2C_eeprom::setFields(uint8_t channels)
+{
+  uint8_t found = 0;
+  _nbrFields = 0;
+  for (uint8_t bit = 0; bit < 8; bit++)
+  {
+    uint8_t channel = 1 << bit;
+    if (!(channels & channel))
+      continue;
+    int8_t field = channelField(channel);
+    if (field < 0)
+      continue;
+    _fields[_nbrFields++] = field;
+    found |= channel;
+  }
+  return found;
+}
+/*
+   putVarint()
+   zigzag so that small negative differences stay small, then 7 bits
+   per byte, the high bit set on all bytes but the last
+*/
+static uint8_t putVarint(uint8_t *buffer, long value)
+{
+  unsigned long v = ((unsigned long)value << 1) ^ (unsigned long)(value >> (sizeof(long) * 8 - 1));
+  uint8_t n = 0;
+  while (v >= 0x80)
+  {
+    buffer[n++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  buffer[n++] = (uint8_t)v;
+  return n;
+}
+
+/*
+   getVarint()
+   returns the number of bytes used, 0 if the varint does not end
+   within len bytes
+*/
+static uint8_t getVarint(const uint8_t *buffer, uint8_t len, long &value)
+{
+  unsigned long v = 0;
+  uint8_t n = 0;
+  while (n < len && n < THRUSTCURVE_VARINT_MAX)
+  {
+    v |= (unsigned long)(buffer[n] & 0x7F) << (7 * n);
+    if ((buffer[n++] & 0x80) == 0)
+    {
+      value = (long)(v >> 1) ^ -(long)(v & 1);
+      return n;
+    }
+  }
+  return 0;
+}
+
+byte logger_I2C_eeprom::begin()
+{
+  Wire.begin();
+  // nothing is recorded to a memory that is not there
+  _storageStatus = _storage->open();
+  return _storageStatus;
+}
+
+/*
+   setStorage()
+   write the curves somewhere else than the memory chosen in config.h,
+   such as a FileStorage on a computer. Call begin() after it
+*/
+void logger_I2C_eeprom::setStorage(StorageDevice &device)
+{
+  _storage = &device;
+}
+
+/*
+   logCheck()
+   checksum of a directory entry, over all its bytes but the last
+*/
+static uint8_t logCheck(const ThrustCurveLogEntry &entry)
+{
+  const uint8_t *b = (const uint8_t *)&entry;
+  uint8_t check = 0x5A;
+  for (uint8_t i = 0; i < sizeof(entry) - 1; i++)
+    check = (uint8_t)((check << 1) | (check >> 7)) ^ b[i];
+  return check;
+}
+
+static void fillLogEntry(ThrustCurveLogEntry &entry, uint8_t type, uint8_t generation, uint8_t seq, uint8_t format, long address)
+{
+  entry.type = type;
+  entry.generation = generation;
+  entry.seq = seq;
+  entry.format = format;
+  entry.address[0] = address & 0xFF;
+  entry.address[1] = (address >> 8) & 0xFF;
+  entry.address[2] = (address >> 16) & 0xFF;
+  entry.check = logCheck(entry);
+}
+
+static long logEntryAddress(const ThrustCurveLogEntry &entry)
+{
+  return (long)entry.address[0] | ((long)entry.address[1] << 8) | ((long)entry.address[2] << 16);
+}
+
+/*
+   logSlotAddress()
+   the log grows down from the end of the eeprom
+*/
+long logger_I2C_eeprom::logSlotAddress(unsigned int slot)
+{
+  return (long)_capacity - (long)(slot + 1) * sizeof(ThrustCurveLogEntry);
+}
+
+/*
+   readLogEntry()
+   true if the slot holds an entry of the current log. Slot 0 is the
+   BEGIN entry and gives the generation of the others
+*/
+boolean logger_I2C_eeprom::readLogEntry(unsigned int slot, ThrustCurveLogEntry &entry)
+{
+  long address = logSlotAddress(slot);
+  if (address <= THRUSTCURVE_DATA_START)
+    return false;
+  readCached(address, (byte*)&entry, sizeof(entry));
+  if (entry.check != logCheck(entry) || entry.seq != (uint8_t)slot)
+    return false;
+  if (slot == 0)
+    return entry.type == THRUSTCURVE_LOG_BEGIN;
+  return entry.generation == _generation && entry.type != THRUSTCURVE_LOG_BEGIN;
+}
+
+void logger_I2C_eeprom::writeLogEntry(unsigned int slot, uint8_t type, uint8_t format, long address)
+{
+  ThrustCurveLogEntry entry;
+  fillLogEntry(entry, type, _generation, (uint8_t)slot, format, address);
+  // let the last page of the curve go first
+  while (poll())
+    ;
+  // the log grows down into a flash block, erase it with its first entry
+  if (_storage->getEraseSize() > 1 &&
+      logSlotAddress(slot) % _storage->getEraseSize() == _storage->getEraseSize() - sizeof(entry))
+    _storage->erase(logSlotAddress(slot));
+  _storage->write(logSlotAddress(slot), (byte*)&entry, sizeof(entry));
+  _readBlockValid = false;
+}
+
+/*
+   scanLog()
+   Read the log and return the number of curves. The curves base and up
+   are kept in _ThrustCurveConfig and their marks in _ThrustCurveMarks.
+   openSlot is the slot of the START entry of a curve that was never
+   committed, 0 if none
+*/
+int logger_I2C_eeprom::scanLog(int base, unsigned int &openSlot)
+{
+  ThrustCurveLogEntry entry;
+  int count = 0;
+  long start = 0;
+  uint8_t format = 0;
+  long trigger = -1;
+  long stop = -1;
+  unsigned int slot;
+
+  _readBlockValid = false;
+  _curveBase = base;
+  openSlot = 0;
+  for (slot = 1; readLogEntry(slot, entry); slot++)
+  {
+    long address = logEntryAddress(entry);
+    switch (entry.type)
+    {
+      case THRUSTCURVE_LOG_START:
+        openSlot = slot;
+        start = address;
+        format = entry.format;
+        trigger = -1;
+        stop = -1;
+        break;
+      case THRUSTCURVE_LOG_MARK:
+        if (entry.format == THRUSTCURVE_MARK_TRIGGER)
+          trigger = address;
+        else if (entry.format == THRUSTCURVE_MARK_STOP)
+          stop = address;
+        break;
+      case THRUSTCURVE_LOG_COMMIT:
+        // a curve closed before its first record is dropped
+        if (openSlot != 0 && address >= start)
+        {
+          if (count >= base && count < base + THRUSTCURVE_CACHE)
+          {
+            _ThrustCurveConfig[count - base].ThrustCurve_start = start | ((long)format << THRUSTCURVE_FORMAT_SHIFT);
+            _ThrustCurveConfig[count - base].ThrustCurve_stop = address;
+            _ThrustCurveMarks[count - base].triggerRecord = trigger;
+            _ThrustCurveMarks[count - base].stopRecord = stop;
+          }
+          count++;
+        }
+        openSlot = 0;
+        break;
+      case THRUSTCURVE_LOG_ERASE:
+        if (count > 0)
+          count--;
+        break;
+    }
+  }
+  _logSlots = slot;
+  return count;
+}
+
+/*
+   findThrustCurve()
+   index in _ThrustCurveConfig of a curve, the log is read again if it
+   is not there. -1 if there is no such curve
+*/
+int logger_I2C_eeprom::findThrustCurve(int ThrustCurveNbr)
+{
+  unsigned int openSlot;
+  if (ThrustCurveNbr < 0 || ThrustCurveNbr >= _curveCount)
+    return -1;
+  if (ThrustCurveNbr < _curveBase || ThrustCurveNbr >= _curveBase + THRUSTCURVE_CACHE)
+    scanLog(ThrustCurveNbr, openSlot);
+  return ThrustCurveNbr - _curveBase;
+}
+
+/*
+   lastCheckpoint()
+   highest end address checkpointed for the curve started at openSlot,
+   openStart - 1 if there is none
+*/
+long logger_I2C_eeprom::lastCheckpoint(unsigned int openSlot, long openStart)
+{
+  ThrustCurveLogEntry entry;
+  long end = openStart - 1;
+  for (uint8_t i = 0; i < THRUSTCURVE_CHECKPOINTS; i++)
+  {
+    _storage->read(THRUSTCURVE_LIST_START + i * sizeof(entry), (byte*)&entry, sizeof(entry));
+    if (entry.check != logCheck(entry) || entry.type != THRUSTCURVE_LOG_CHECKPOINT ||
+        entry.generation != _generation || entry.seq != (uint8_t)openSlot)
+      continue;
+    long address = logEntryAddress(entry);
+    if (address > end && address < logSlotAddress(_logSlots))
+      end = address;
+  }
+  return end;
+}
+
+/*
+   migrateThrustCurveList()
+   Start the log with the curves of the old 25 curve list. The BEGIN
+   entry is written last so that a power loss in between starts again
+*/
+void logger_I2C_eeprom::migrateThrustCurveList()
+{
+  ThrustCurveConfigStruct old;
+  unsigned int slot = 1;
+  _generation = 0;
+  // there never was a list on a flash
+  for (int i = 0; i < 25 && _storage->getEraseSize() == 1; i++)
+  {
+    _storage->read(THRUSTCURVE_LIST_START + i * sizeof(old), (byte*)&old, sizeof(old));
+    long start = old.ThrustCurve_start & THRUSTCURVE_ADDRESS_MASK;
+    if (start <= THRUSTCURVE_DATA_START || old.ThrustCurve_stop < start)
+      break;
+    // the end of the last curves may now be under the log
+    long floor = logSlotAddress(slot + 2 + THRUSTCURVE_LOG_SPARE);
+    if (start >= floor)
+      break;
+    writeLogEntry(slot++, THRUSTCURVE_LOG_START, (unsigned long)old.ThrustCurve_start >> THRUSTCURVE_FORMAT_SHIFT, start);
+    writeLogEntry(slot++, THRUSTCURVE_LOG_COMMIT, 0, old.ThrustCurve_stop < floor ? old.ThrustCurve_stop : floor - 1);
+  }
+  writeLogEntry(0, THRUSTCURVE_LOG_BEGIN, 0, 0);
+}
+
+/*
+   clearThrustCurveList()
+   Clear the Thrust Curve list. Rather than clearing the entire eeprom
+   let's just start a new log, the entries of the old one have another
+   generation and are ignored
+*/
+void logger_I2C_eeprom::clearThrustCurveList()
+{
+  _generation++;
+  writeLogEntry(0, THRUSTCURVE_LOG_BEGIN, 0, 0);
+  _logSlots = 1;
+  _curveBase = 0;
+  _curveCount = 0;
+  _lastEnd = THRUSTCURVE_DATA_START;
+  _curveOpen = false;
+}
+
+
+/*
+   readThrustCurveList()
+   Read the directory, close the curve that was being recorded when the
+   power went at its last checkpoint. Returns the number of curves
+*/
+int logger_I2C_eeprom::readThrustCurveList()
+{
+  ThrustCurveLogEntry entry;
+  unsigned int openSlot;
+
+  _readBlockValid = false;
+  _curveOpen = false;
+  if (readLogEntry(0, entry))
+    _generation = entry.generation;
+  else
+    migrateThrustCurveList();
+
+  _curveCount = scanLog(0, openSlot);
+  if (openSlot != 0)
+  {
+    readLogEntry(openSlot, entry);
+    writeLogEntry(_logSlots, THRUSTCURVE_LOG_COMMIT, 0, lastCheckpoint(openSlot, logEntryAddress(entry)));
+    _curveCount = scanLog(0, openSlot);
+  }
+  if (_curveCount > THRUSTCURVE_CACHE)
+    scanLog(_curveCount - THRUSTCURVE_CACHE, openSlot);
+  _lastEnd = _curveCount > 0 ? getThrustCurveStop(_curveCount - 1) : THRUSTCURVE_DATA_START;
+  return _curveCount;
+}
+/*
+   readThrustCurve(int eeaddress)
+
+*/
+unsigned long logger_I2C_eeprom::readThrustCurve(unsigned long eeaddress)
+{
+  readCached(eeaddress, ((byte*)&_ThrustCurveData), sizeof(_ThrustCurveData));
+  return eeaddress + sizeof(_ThrustCurveData);
+}
+
+/*
+   readCompactThrustCurve(int eeaddress)
+   Decode a compact record, they have to be read in order from the start
+   of the curve. Returns the address of the next record.
+*/
+unsigned long logger_I2C_eeprom::readCompactThrustCurve(unsigned long eeaddress)
+{
+  uint8_t record[THRUSTCURVE_COMPACT_MAX];
+  readCached(eeaddress, record, 1);
+  uint8_t len = record[0] & ~THRUSTCURVE_KEYFRAME;
+  boolean keyframe = (record[0] & THRUSTCURVE_KEYFRAME) != 0;
+  // a bad length, keep the previous record
+  if (len > sizeof(record) - 1)
+    return eeaddress + 1 + len;
+  readCached(eeaddress + 1, record + 1, len);
+
+  long *values = (long*)&_ThrustCurveData;
+  uint8_t n = 1;
+  for (uint8_t i = 0; i < _nbrFields; i++)
+  {
+    uint8_t f = _fields[i];
+    long value = 0;
+    uint8_t used = getVarint(record + n, len + 1 - n, value);
+    if (used == 0)
+      break;
+    n += used;
+    _compactData[f] = keyframe ? value : _compactData[f] + value;
+    values[f] = _compactData[f];
+  }
+  implicitTime();
+  return eeaddress + 1 + len;
+}
+
+/*
+   readPackedThrustCurve(int eeaddress)
+   Read a record of a curve with a header that is not compact,
+   4 bytes per field of its channels
+*/
+unsigned long logger_I2C_eeprom::readPackedThrustCurve(unsigned long eeaddress)
+{
+  long *values = (long*)&_ThrustCurveData;
+  for (uint8_t i = 0; i < _nbrFields; i++)
+  {
+    readCached(eeaddress, (byte*)&values[_fields[i]], sizeof(long));
+    eeaddress += sizeof(long);
+  }
+  implicitTime();
+  return eeaddress;
+}
+
+/*
+   readCached()
+   The records are read in order, fetch a whole block at a time rather
+   than paying an I2C transaction for each few bytes
+*/
+void logger_I2C_eeprom::readCached(unsigned long eeaddress, byte *values, unsigned int nBytes)
+{
+  while (nBytes > 0)
+  {
+    unsigned long block = eeaddress & ~((unsigned long)LOGGER_READ_BLOCK - 1);
+    if (!_readBlockValid || block != _readBlockAddr)
+    {
+      _storage->read(block, _readBlock, LOGGER_READ_BLOCK);
+      _readBlockAddr = block;
+      _readBlockValid = true;
+    }
+    uint16_t offset = eeaddress - block;
+    uint16_t nCopy = LOGGER_READ_BLOCK - offset;
+    if (nBytes < nCopy)
+      nCopy = nBytes;
+    memcpy(values, _readBlock + offset, nCopy);
+    eeaddress += nCopy;
+    values += nCopy;
+    nBytes -= nCopy;
+  }
+}
+
+/*
+   implicitTime()
+   When diffTime is not stored the records are on the sample clock grid,
+   give each one the same diffTime the recorder had
+*/
+void logger_I2C_eeprom::implicitTime()
+{
+  if (!(_readFormat & THRUSTCURVE_FORMAT_HEADER) || (_ThrustCurveHeader.channels & THRUSTCURVE_CH_TIME))
+    return;
+  long period = _ThrustCurveHeader.samplePeriod;
+  _ThrustCurveData.diffTime = ((_readCount + 1) * period) / 1000 - (_readCount * period) / 1000;
+  _readCount++;
+}
+
+/*
+   readThrustCurveHeader(int eeaddress)
+   Read the header at the start of a curve and get ready to read its
+   records. Returns the address of the first record.
+*/
+unsigned long logger_I2C_eeprom::readThrustCurveHeader(unsigned long eeaddress)
+{
+  readCached(eeaddress, (byte*)&_ThrustCurveHeader, THRUSTCURVE_HEADER_V1_SIZE);
+  unsigned int headerSize = THRUSTCURVE_HEADER_V1_SIZE;
+  _ThrustCurveHeader.triggerTime = 0;
+  if (_ThrustCurveHeader.version >= 2) {
+    readCached(eeaddress + headerSize, (byte*)&_ThrustCurveHeader.triggerTime, sizeof(_ThrustCurveHeader.triggerTime));
+    headerSize = sizeof(_ThrustCurveHeader);
+  }
+  // the fields that are not stored read as 0
+  memset(&_ThrustCurveData, 0, sizeof(_ThrustCurveData));
+  setFields(_ThrustCurveHeader.channels);
+  _readCount = 0;
+  return eeaddress + headerSize;
+}
+
+/*
+   writeThrustCurveHeader()
+   Call after setThrustCurveFormat(), the records that follow will only
+   hold the fields of these channels. triggerTime is the time the records
+   written before the trigger cover, the dump starts that many ms before 0.
+   Returns the address of the first record.
+*/
+unsigned long logger_I2C_eeprom::writeThrustCurveHeader(int ThrustCurveNbr, unsigned long eeaddress, uint8_t channels, long samplePeriod, int unit, long calibration_factor, long current_offset, long triggerTime)
+{
+  _ThrustCurveHeader.version = THRUSTCURVE_HEADER_VERSION;
+  _ThrustCurveHeader.unit = unit;
+  _ThrustCurveHeader.channels = setFields(channels);
+  _ThrustCurveHeader.spare = 0;
+  _ThrustCurveHeader.samplePeriod = samplePeriod;
+  _ThrustCurveHeader.calibration_factor = calibration_factor;
+  _ThrustCurveHeader.current_offset = current_offset;
+  _ThrustCurveHeader.triggerTime = triggerTime;
+  setThrustCurveFormat(ThrustCurveNbr, (_writeFormat & THRUSTCURVE_FORMAT_MASK) | THRUSTCURVE_FORMAT_HEADER);
+  return stageBytes(eeaddress, (byte*)&_ThrustCurveHeader, sizeof(_ThrustCurveHeader));
+}
+
+/*
+   getRecordsForSample()
+   Number of records to write for a sample. Without diffTime each record
+   is one tick of the sample clock, the ticks that were missed are filled
+   with the same sample so that the time stays right.
+*/
+int logger_I2C_eeprom::getRecordsForSample(long diffTime)
+{
+  if (!(_writeFormat & THRUSTCURVE_FORMAT_HEADER) || (_ThrustCurveHeader.channels & THRUSTCURVE_CH_TIME))
+    return 1;
+  long period = _ThrustCurveHeader.samplePeriod;
+  if (period <= 0)
+    return 1;
+  long records = (diffTime * 1000 + period / 2) / period;
+  return records < 1 ? 1 : (int)records;
+}
+
+/*
+   writeThrustCurveList()
+   Commit the curve being recorded to the directory
+*/
+int logger_I2C_eeprom::writeThrustCurveList()
+{
+  if (_curveOpen)
+  {
+    if (_openSlot == 0 && _openEnd >= _openStart)
+      writeLogEntry(_openSlot = _logSlots++, THRUSTCURVE_LOG_START, _openFormat, _openStart);
+    if (_openSlot != 0)
+    {
+      if (_openTrigger >= 0)
+        writeLogEntry(_logSlots++, THRUSTCURVE_LOG_MARK, THRUSTCURVE_MARK_TRIGGER, _openTrigger);
+      if (_openStop >= 0)
+        writeLogEntry(_logSlots++, THRUSTCURVE_LOG_MARK, THRUSTCURVE_MARK_STOP, _openStop);
+      writeLogEntry(_logSlots++, THRUSTCURVE_LOG_COMMIT, 0, _openEnd);
+    }
+    if (_openEnd >= _openStart)
+    {
+      int i = _curveCount - _curveBase;
+      if (i >= 0 && i < THRUSTCURVE_CACHE)
+      {
+        _ThrustCurveConfig[i].ThrustCurve_start = _openStart | ((long)_openFormat << THRUSTCURVE_FORMAT_SHIFT);
+        _ThrustCurveConfig[i].ThrustCurve_stop = _openEnd;
+        _ThrustCurveMarks[i].triggerRecord = _openTrigger;
+        _ThrustCurveMarks[i].stopRecord = _openStop;
+      }
+      _curveCount++;
+      _lastEnd = _openEnd;
+    }
+    _curveOpen = false;
+  }
+  return _logSlots;
+}
+
+/*
+   getThrustCurveRecords()
+   records written in the curve being recorded, the index of the next one
+*/
+long logger_I2C_eeprom::getThrustCurveRecords()
+{
+  return _writeCount;
+}
+
+/*
+   setThrustCurveMarks()
+   record indexes of the trigger and of the end of the burn of the curve
+   being recorded, -1 for none. They go in the log with the curve
+*/
+void logger_I2C_eeprom::setThrustCurveMarks(long triggerRecord, long stopRecord)
+{
+  _openTrigger = triggerRecord;
+  _openStop = stopRecord;
+}
+
+/*
+   getThrustCurveMarks()
+   record indexes of the trigger and of the end of the burn of a curve,
+   -1 if they were not found. They were read with the directory
+*/
+void logger_I2C_eeprom::getThrustCurveMarks(int ThrustCurveNbr, long &triggerRecord, long &stopRecord)
+{
+  int i = findThrustCurve(ThrustCurveNbr);
+  if (i < 0)
+  {
+    triggerRecord = -1;
+    stopRecord = -1;
+    return;
+  }
+  triggerRecord = _ThrustCurveMarks[i].triggerRecord;
+  stopRecord = _ThrustCurveMarks[i].stopRecord;
+}
+
+/*
+   checkpointThrustCurve()
+   Save how far the curve being recorded is in the eeprom, call it every
+   THRUSTCURVE_CHECKPOINT_MS or so while recording. The checkpoints go
+   round the old list room so that no byte is written too often
+*/
+void logger_I2C_eeprom::checkpointThrustCurve()
+{
+  ThrustCurveLogEntry entry;
+  if (!_curveOpen || _durableEnd < _openStart)
+    return;
+  if (_openSlot == 0)
+    writeLogEntry(_openSlot = _logSlots++, THRUSTCURVE_LOG_START, _openFormat, _openStart);
+  while (poll())
+    ;
+  // what the checkpoint says is written must be in the memory
+  _storage->sync();
+  // a flash cannot write the slots again, erase them before going round.
+  // The data starts on the next block then
+  if (_checkpointSlot == 0 && _storage->getEraseSize() > 1)
+    _storage->erase(THRUSTCURVE_LIST_START);
+  fillLogEntry(entry, THRUSTCURVE_LOG_CHECKPOINT, _generation, (uint8_t)_openSlot, 0, _durableEnd);
+  _storage->write(THRUSTCURVE_LIST_START + _checkpointSlot * sizeof(entry), (byte*)&entry, sizeof(entry));
+  _checkpointSlot = (_checkpointSlot + 1) % THRUSTCURVE_CHECKPOINTS;
+}
+
+/*
+   getDataEnd()
+   last address the curves can use, the log needs the rest
+*/
+long logger_I2C_eeprom::getDataEnd()
+{
+  long end = logSlotAddress(_logSlots + THRUSTCURVE_LOG_SPARE);
+  // not in a flash block the log will erase
+  if (_storage->getEraseSize() > 1)
+    end -= end % _storage->getEraseSize() + 1;
+  return end;
+}
+
+/*
+   getNextCurveStart()
+   where the next curve goes, after the last one. On a flash it is the
+   next erase block so that the erase does not touch the last curve
+*/
+long logger_I2C_eeprom::getNextCurveStart()
+{
+  unsigned long block = _storage->getEraseSize();
+  long start = _curveCount > 0 ? _lastEnd + 1 : THRUSTCURVE_DATA_START + 1;
+  if (block > 1)
+    start = (start + block - 1) / block * block;
+  return start;
+}
+
+/*
+   writeFastThrustCurve(int eeaddress)
+   Write the record in the format set by setThrustCurveFormat() and
+   return the address of the next one.
+   The record is only copied in the page staging buffer. The page is
+   written to the eeprom when it is full or when the next record is on
+   another page, so we pay one write cycle per page rather than one per
+   record. The write is started and left to poll() while we fill the
+   other staging buffer. Call flushThrustCurve() at the end of the
+   recording.
+*/
+unsigned long logger_I2C_eeprom::writeFastThrustCurve(unsigned long eeaddress)
+{
+  uint8_t record[THRUSTCURVE_COMPACT_MAX];
+  long *values = (long*)&_ThrustCurveData;
+  uint8_t n = 0;
+
+  _writeCount++;
+  if ((_writeFormat & THRUSTCURVE_FORMAT_MASK) == THRUSTCURVE_FORMAT_COMPACT)
+  {
+    boolean keyframe = (_compactCount % THRUSTCURVE_KEYFRAME_INTERVAL) == 0;
+    n = 1;
+    for (uint8_t i = 0; i < _nbrFields; i++)
+    {
+      uint8_t f = _fields[i];
+      n += putVarint(record + n, keyframe ? values[f] : values[f] - _compactData[f]);
+      _compactData[f] = values[f];
+    }
+    record[0] = (n - 1) | (keyframe ? THRUSTCURVE_KEYFRAME : 0);
+    _compactCount++;
+    return stageBytes(eeaddress, record, n);
+  }
+  if (!(_writeFormat & THRUSTCURVE_FORMAT_HEADER))
+  {
+    // the raw records are one byte apart
+    return stageBytes(eeaddress, (byte*)&_ThrustCurveData, sizeof(_ThrustCurveData)) + 1;
+  }
+  for (uint8_t i = 0; i < _nbrFields; i++)
+  {
+    memcpy(record + n, &values[_fields[i]], sizeof(long));
+    n += sizeof(long);
+  }
+  return stageBytes(eeaddress, record, n);
+}
+
+/*
+   stageBytes()
+   copy bytes in the page staging buffer, returns the next address
+*/
+unsigned long logger_I2C_eeprom::stageBytes(unsigned long eeaddress, byte *values, unsigned int nBytes)
+{
+  while (nBytes > 0)
+  {
+    unsigned long page = eeaddress & ~((unsigned long)LOGGER_I2C_EEPROM_PAGESIZE - 1);
+    if (_stageTo > 0 && page != _stagePage)
+      writeStagedPage();
+    uint16_t offset = eeaddress - page;
+    if (_stageTo == 0)
+    {
+      _stagePage = page;
+      _stageFrom = offset;
+    }
+    uint16_t nCopy = LOGGER_I2C_EEPROM_PAGESIZE - offset;
+    if (nBytes < nCopy)
+      nCopy = nBytes;
+    memcpy(_stage + offset, values, nCopy);
+    _stageTo = offset + nCopy;
+    if (_stageTo == LOGGER_I2C_EEPROM_PAGESIZE)
+      writeStagedPage();
+
+    eeaddress += nCopy;
+    values += nCopy;
+    nBytes -= nCopy;
+  }
+  return eeaddress;
+}
+
+/*
+   writeStagedPage()
+   Start writing the staged page and switch to the other staging buffer.
+   Only waits if the previous page is still being written.
+*/
+void logger_I2C_eeprom::writeStagedPage()
+{
+  if (_stageTo > _stageFrom)
+  {
+    while (poll())
+      ;
+    // a flash block is erased by poll() while the one before is filled,
+    // or here if there was no time for it. The curves start on a block
+    unsigned long block = _storage->getEraseSize();
+    unsigned long address = _stagePage + _stageFrom;
+    if (block > 1 && address % block == 0)
+    {
+      if (address >= _erasedTo)
+      {
+        _storage->erase(address);
+        _storage->waitReady();
+      }
+      _erasedTo = address + block;
+      if ((long)(address + 2 * block) <= getDataEnd() + 1)
+        _eraseAhead = address + block;
+    }
+    byte status = _storage->writeAsync(_stagePage + _stageFrom, _stage + _stageFrom, _stageTo - _stageFrom);
+    if (status == 0)
+    {
+      _writePending = true;
+      _durableEnd = _stagePage + _stageTo - 1;
+    }
+    else
+      _writeErrors++;
+    _stage = (_stage == _stageBuffer[0]) ? _stageBuffer[1] : _stageBuffer[0];
+  }
+  _stageFrom = 0;
+  _stageTo = 0;
+}
+
+/*
+   flushThrustCurve()
+   Write what is left in the page staging buffer and wait until
+   everything is in the eeprom
+*/
+void logger_I2C_eeprom::flushThrustCurve()
+{
+  writeStagedPage();
+  while (poll())
+    ;
+  if (_storage->sync() != 0)
+    _writeErrors++;
+}
+
+/*
+   poll()
+   Move the pending page write forward, call it whenever there is time
+   to spare. Returns true while a page is being written.
+*/
+boolean logger_I2C_eeprom::poll()
+{
+  if (_writePending)
+  {
+    byte status = _storage->poll();
+    if (status != STORAGE_BUSY)
+    {
+      _writePending = false;
+      if (status != 0)
+        _writeErrors++;
+    }
+  }
+  // erase the next flash block when there is nothing to write
+  if (!_writePending && _eraseAhead != 0)
+  {
+    if (_storage->erase(_eraseAhead) == 0)
+    {
+      _erasedTo = _eraseAhead + _storage->getEraseSize();
+      _writePending = true;
+    }
+    else
+      _writeErrors++;
+    _eraseAhead = 0;
+  }
+  return _writePending;
+}
+
+/*
+   getWriteErrors()
+   number of page writes that failed since power up
+*/
+long logger_I2C_eeprom::getWriteErrors()
+{
+  return _writeErrors;
+}
+
+/*
+
+   getLastThrustCurveNbr()
+   return -1 if no thrust curves have been recorded else return the thrust curve number
+
+*/
+int logger_I2C_eeprom::getLastThrustCurveNbr()
+{
+  return _curveCount - 1;
+}
+
+/*
+
+  eraseLastThrustCurve()
+
+*/
+bool logger_I2C_eeprom::eraseLastThrustCurve() {
+  if (_curveCount == 0)
+    return false;
+  writeLogEntry(_logSlots++, THRUSTCURVE_LOG_ERASE, 0, 0);
+  _curveCount--;
+  _lastEnd = _curveCount > 0 ? getThrustCurveStop(_curveCount - 1) : THRUSTCURVE_DATA_START;
+  return true;
+}
+
+/*
+
+   getLastThrustCurveEndAddress()
+   end address of the last ThrustCurve, THRUSTCURVE_DATA_START if there is none
+
+*/
+long logger_I2C_eeprom::getLastThrustCurveEndAddress()
+{
+  return _lastEnd;
+}
+
+/*
+
+   printThrustCurveList()
+
+
+*/
+int logger_I2C_eeprom::printThrustCurveList()
+{
+  int i;
+  for (i = 0; i < _curveCount; i++)
+  {
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    Serial.print("ThrustCurve Nbr: ");
+    Serial.println(i);
+    Serial.print("Start: ");
+    Serial.println(getThrustCurveStart(i));
+    Serial.print("End: ");
+    Serial.println(getThrustCurveStop(i));
+#endif
+    SerialCom.print("ThrustCurve Nbr: ");
+    SerialCom.println(i);
+    SerialCom.print("Start: ");
+    SerialCom.println(getThrustCurveStart(i));
+    SerialCom.print("End: ");
+    SerialCom.println(getThrustCurveStop(i));
+  }
+  return i;
+}
+
+/*
+   setThrustCurveStartAddress()
+   open a new curve, it only goes in the directory when
+   writeThrustCurveList() commits it or a checkpoint is taken
+*/
+void logger_I2C_eeprom::setThrustCurveStartAddress(int ThrustCurveNbr, long startAddress)
+{
+  _curveOpen = true;
+  _openStart = startAddress;
+  _openEnd = startAddress - 1;
+  _openFormat = 0;
+  _openSlot = 0;
+  _durableEnd = startAddress - 1;
+  _writeCount = 0;
+  _openTrigger = -1;
+  _openStop = -1;
+  // erase the first flash block before the samples come
+  if (_storage->getEraseSize() > 1)
+  {
+    while (poll())
+      ;
+    _storage->erase(startAddress);
+    _storage->waitReady();
+    _erasedTo = startAddress + _storage->getEraseSize();
+  }
+}
+
+void logger_I2C_eeprom::setThrustCurveEndAddress(int ThrustCurveNbr, long endAddress)
+{
+  _openEnd = endAddress;
+}
+
+/*
+   setThrustCurveFormat()
+   set after the start address, the following records are written
+   in that format
+*/
+void logger_I2C_eeprom::setThrustCurveFormat(int ThrustCurveNbr, int format)
+{
+  _openFormat = format;
+  _writeFormat = format;
+  _compactCount = 0;
+  if (!(format & THRUSTCURVE_FORMAT_HEADER))
+    setFields(THRUSTCURVE_CH_ALL);
+}
+
+int logger_I2C_eeprom::getThrustCurveFormat(int ThrustCurveNbr)
+{
+  int i = findThrustCurve(ThrustCurveNbr);
+  if (i < 0)
+    return THRUSTCURVE_FORMAT_RAW;
+  return (int)((unsigned long)_ThrustCurveConfig[i].ThrustCurve_start >> THRUSTCURVE_FORMAT_SHIFT);
+}
+
+void logger_I2C_eeprom::setThrustCurveTimeData( long difftime)
+{
+  _ThrustCurveData.diffTime = difftime;
+}
+void logger_I2C_eeprom::setThrustCurveData( long thrust)
+{
+  _ThrustCurveData.thrust = thrust;
+}
+
+long logger_I2C_eeprom::getThrustCurveStart(int ThrustCurveNbr)
+{
+  int i = findThrustCurve(ThrustCurveNbr);
+  if (i < 0)
+    return 0;
+  return  _ThrustCurveConfig[i].ThrustCurve_start & THRUSTCURVE_ADDRESS_MASK;
+}
+long logger_I2C_eeprom::getThrustCurveStop(int ThrustCurveNbr)
+{
+  int i = findThrustCurve(ThrustCurveNbr);
+  if (i < 0)
+    return 0;
+  return  _ThrustCurveConfig[i].ThrustCurve_stop;
+}
+long logger_I2C_eeprom::getThrustCurveTimeData()
+{
+  return _ThrustCurveData.diffTime;
+}
+long logger_I2C_eeprom::getThrustCurveData()
+{
+  return _ThrustCurveData.thrust;
+}
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+long logger_I2C_eeprom::getPressureCurveData()
+{
+  return _ThrustCurveData.casing_pressure;
+}
+void logger_I2C_eeprom::setPressureCurveData( long pressure)
+{
+  _ThrustCurveData.casing_pressure = pressure;
+}
+#endif
+
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+long logger_I2C_eeprom::getPressureCurveData2()
+{
+  return _ThrustCurveData.casing_pressure2;
+}
+void logger_I2C_eeprom::setPressureCurveData2( long pressure)
+{
+  _ThrustCurveData.casing_pressure2 = pressure;
+}
+long logger_I2C_eeprom::getThrustCurveDataFiltered()
+{
+  return _ThrustCurveData.thrust_filtered;
+}
+void logger_I2C_eeprom::setThrustCurveDataFiltered( long thrust)
+{
+  _ThrustCurveData.thrust_filtered = thrust;
+}
+#endif
+#if NBR_LOADCELLS > 1
+// channel 1 to NBR_LOADCELLS - 1, channel 0 is the thrust
+void logger_I2C_eeprom::setThrustCurveDataChannel(int channel, long thrust)
+{
+  _ThrustCurveData.thrust_channel[channel - 1] = thrust;
+}
+long logger_I2C_eeprom::getThrustCurveDataChannel(int channel)
+{
+  return _ThrustCurveData.thrust_channel[channel - 1];
+}
+#endif
+
+/*
+   getSizeOfThrustCurveData()
+   largest size of a record in the current format
+*/
+long logger_I2C_eeprom::getSizeOfThrustCurveData()
+{
+  if ((_writeFormat & THRUSTCURVE_FORMAT_MASK) == THRUSTCURVE_FORMAT_COMPACT)
+    return 1 + _nbrFields * THRUSTCURVE_VARINT_MAX;
+  if (_writeFormat & THRUSTCURVE_FORMAT_HEADER)
+    return _nbrFields * sizeof(long);
+  return sizeof(_ThrustCurveData);
+}
+
+void logger_I2C_eeprom::printThrustCurveData(int ThrustCurveNbr)
+{
+  unsigned long startaddress;
+  unsigned long endaddress;
+
+  startaddress = getThrustCurveStart(ThrustCurveNbr);
+  endaddress = getThrustCurveStop(ThrustCurveNbr);
+
+  if (startaddress > 200)
+  {
+    unsigned long i = startaddress;
+    // time from the trigger, the pre-trigger records are before 0
+    long currentTime = 0;
+    // the eeprom may have been written since the last dump
+    _readBlockValid = false;
+    _readFormat = getThrustCurveFormat(ThrustCurveNbr);
+    if (_readFormat & THRUSTCURVE_FORMAT_HEADER)
+    {
+      i = readThrustCurveHeader(i);
+      printThrustCurveHeader(ThrustCurveNbr);
+      currentTime = -_ThrustCurveHeader.triggerTime;
+    }
+    else
+      setFields(THRUSTCURVE_CH_ALL);
+
+    while (i < (endaddress + 1))
+    {
+      if ((_readFormat & THRUSTCURVE_FORMAT_MASK) == THRUSTCURVE_FORMAT_COMPACT)
+        i = readCompactThrustCurve(i);
+      else if (_readFormat & THRUSTCURVE_FORMAT_HEADER)
+        i = readPackedThrustCurve(i);
+      else
+        i = readThrustCurve(i) + 1;
+      char ThrustCurveData[160] = "";
+      char temp[20] = "";
+      currentTime = currentTime + getThrustCurveTimeData();
+      strcat(ThrustCurveData, "data,");
+      sprintf(temp, "%i,", ThrustCurveNbr );
+      strcat(ThrustCurveData, temp);
+      sprintf(temp, "%i,", (int) currentTime );
+      //sprintf(temp, "%lu,", currentTime );
+      strcat(ThrustCurveData, temp);
+      sprintf(temp, "%i,", (int)getThrustCurveData() );
+      strcat(ThrustCurveData, temp);
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+      sprintf(temp, "%i,", (int)getPressureCurveData() );
+      strcat(ThrustCurveData, temp);
+#endif
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+      sprintf(temp, "%i,", (int)getPressureCurveData2() );
+      strcat(ThrustCurveData, temp);
+      sprintf(temp, "%i,", (int)getThrustCurveDataFiltered() );
+      strcat(ThrustCurveData, temp);
+#endif
+#if NBR_LOADCELLS > 1
+      for (int c = 1; c < NBR_LOADCELLS; c++) {
+        sprintf(temp, "%i,", (int)getThrustCurveDataChannel(c) );
+        strcat(ThrustCurveData, temp);
+      }
+#endif
+      unsigned int chk = msgChk(ThrustCurveData, sizeof(ThrustCurveData));
+      sprintf(temp, "%i", chk);
+      strcat(ThrustCurveData, temp);
+      strcat(ThrustCurveData, ";\n");
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+      Serial.print("$");
+      Serial.print(ThrustCurveData);
+#endif
+      SerialCom.print("$");
+      SerialCom.print(ThrustCurveData);
+
+      //This will slow down the data
+      // this is for telemetry modules without enought buffer
+      if (config.telemetryType == 0)
+        delay(0);
+      else if (config.telemetryType == 1)
+        delay(20);
+      else if (config.telemetryType == 2)
+        delay(50);
+      else if (config.telemetryType == 3)
+        delay(100);
+    }
+  }
+}
+/*
+   printThrustCurveHeader()
+   Describe a curve before its data so that any board can make sense of
+   it: curve number, header version, unit, channels, sample period in us,
+   calibration factor and offset
+*/
+void logger_I2C_eeprom::printThrustCurveHeader(int ThrustCurveNbr)
+{
+  char ThrustCurveHeader[100] = "";
+  char temp[20] = "";
+  strcat(ThrustCurveHeader, "curveheader,");
+  sprintf(temp, "%i,", ThrustCurveNbr );
+  strcat(ThrustCurveHeader, temp);
+  sprintf(temp, "%i,", (int)_ThrustCurveHeader.version );
+  strcat(ThrustCurveHeader, temp);
+  sprintf(temp, "%i,", (int)_ThrustCurveHeader.unit );
+  strcat(ThrustCurveHeader, temp);
+  sprintf(temp, "%i,", (int)_ThrustCurveHeader.channels );
+  strcat(ThrustCurveHeader, temp);
+  sprintf(temp, "%ld,", (long)_ThrustCurveHeader.samplePeriod );
+  strcat(ThrustCurveHeader, temp);
+  sprintf(temp, "%ld,", (long)_ThrustCurveHeader.calibration_factor );
+  strcat(ThrustCurveHeader, temp);
+  sprintf(temp, "%ld,", (long)_ThrustCurveHeader.current_offset );
+  strcat(ThrustCurveHeader, temp);
+  sprintf(temp, "%ld,", (long)_ThrustCurveHeader.triggerTime );
+  strcat(ThrustCurveHeader, temp);
+  long triggerRecord, stopRecord;
+  getThrustCurveMarks(ThrustCurveNbr, triggerRecord, stopRecord);
+  sprintf(temp, "%ld,", triggerRecord );
+  strcat(ThrustCurveHeader, temp);
+  sprintf(temp, "%ld,", stopRecord );
+  strcat(ThrustCurveHeader, temp);
+  unsigned int chk = msgChk(ThrustCurveHeader, sizeof(ThrustCurveHeader));
+  sprintf(temp, "%i", chk);
+  strcat(ThrustCurveHeader, temp);
+  strcat(ThrustCurveHeader, ";\n");
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  Serial.print("$");
+  Serial.print(ThrustCurveHeader);
+#endif
+  SerialCom.print("$");
+  SerialCom.print(ThrustCurveHeader);
+}
+
+/*
+   CanRecord()
+   if the next Thrust Curve starts past the last address left by the
+   directory then the EEprom is full. False as well if the memory did
+   not answer begin()
+*/
+boolean logger_I2C_eeprom::CanRecord()
+{
+  if (_storageStatus != 0)
+    return false;
+  // Check if eeprom is full
+  if (getNextCurveStart() > getDataEnd() - THRUSTCURVE_FULL_MARGIN)
+  {
+    return false;
+  }
+  return true;
+}
+
+static void printMemoryTest(const char *label, long value)
+{
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  Serial.print(label);
+  Serial.println(value);
+#endif
+  SerialCom.print(label);
+  SerialCom.println(value);
+}
+
+/*
+   marchData()
+   data of the march test, the address of each byte folded in a byte so
+   that the bytes of a page are told apart, or its complement. Each bit
+   goes from 0 to 1 and from 1 to 0 in the test
+*/
+static uint8_t marchData(long address, uint8_t complement)
+{
+  uint8_t folded = (uint8_t)(address ^ (address >> 8) ^ (address >> 16));
+  return complement ? ~folded : folded;
+}
+
+void logger_I2C_eeprom::reportMemoryError(long address, long errors)
+{
+  if (errors <= LOGGER_TEST_REPORT_MAX)
+    printMemoryTest("Error at: ", address);
+}
+
+/*
+   marchElement()
+   One element of the March C- test: the pages from start to end, going
+   up or down, are each read and checked against the expect data then
+   written at once with the write data. -1 skips the read or the write.
+   The bad bytes are flagged in bad, from start on. cell holds a page
+*/
+void logger_I2C_eeprom::marchElement(long start, long end, boolean up, int8_t expect, int8_t write, uint8_t *bad, uint8_t *cell)
+{
+  long pages = (end - start + LOGGER_I2C_EEPROM_PAGESIZE - 1) / LOGGER_I2C_EEPROM_PAGESIZE;
+
+  for (long k = 0; k < pages; k++)
+  {
+    long address = start + (up ? k : pages - 1 - k) * LOGGER_I2C_EEPROM_PAGESIZE;
+    unsigned int n = end - address < LOGGER_I2C_EEPROM_PAGESIZE ? end - address : LOGGER_I2C_EEPROM_PAGESIZE;
+    if (expect >= 0)
+    {
+      _storage->read(address, cell, n);
+      for (unsigned int i = 0; i < n; i++)
+      {
+        unsigned int b = address - start + i;
+        if (cell[i] != marchData(address + i, expect))
+          bad[b >> 3] |= 1 << (b & 7);
+      }
+    }
+    if (write >= 0)
+    {
+      for (unsigned int i = 0; i < n; i++)
+        cell[i] = marchData(address + i, write);
+      _storage->write(address, cell, n);
+    }
+  }
+}
+
+/*
+   checkMemoryErrors()
+   Test the eeprom up to memoryLastAddress without losing what is in it.
+   The address lines are checked first. Then the eeprom is taken two
+   pages at a time: both pages are saved in the staging buffers and
+   March C- is run on them, a whole page being a cell:
+     up (w0); up (r0, w1); up (r1, w0); down (r0, w1); down (r1, w0); up (r0)
+   so that a write that disturbs the other page of the pair is seen,
+   then they are written back. That is 6 page writes per page. A write
+   that disturbs a byte of its own page, or of the neighbouring pair,
+   is not seen.
+   The writes wait for the eeprom with ACK polling. A 64KB eeprom takes
+   3072 page writes, with 64 byte chip pages and the 32 byte Wire buffer
+   of the Atmega and STM32 that is 18432 write cycles, about 90 s at the
+   5 ms worst case of the 24LC512 and less with its typical cycle; the
+   128 byte Wire buffer of the ESP32 needs 6144, about 30 s.
+   Prints the progress and the first failing addresses, returns the
+   number of bad bytes, -1 on a flash that cannot be written over
+*/
+long logger_I2C_eeprom::checkMemoryErrors(long memoryLastAddress) {
+  long errors;
+  uint8_t progress = 0;
+  // the staging buffers are free when not recording, one for each page
+  // of the pair
+  uint8_t *saved = _stageBuffer[0];
+  uint8_t *savedNext = _stageBuffer[1];
+  uint8_t bad[2 * LOGGER_I2C_EEPROM_PAGESIZE / 8];
+  uint8_t cell[LOGGER_I2C_EEPROM_PAGESIZE];
+
+  // the patterns are written over each other
+  if (_storage->getEraseSize() > 1)
+    return -1;
+  flushThrustCurve();
+  errors = checkAddressLines(memoryLastAddress);
+  for (long page = 0; page < memoryLastAddress; page += 2 * LOGGER_I2C_EEPROM_PAGESIZE)
+  {
+    long next = page + LOGGER_I2C_EEPROM_PAGESIZE;
+    long end = page + 2 * LOGGER_I2C_EEPROM_PAGESIZE < memoryLastAddress ? page + 2 * LOGGER_I2C_EEPROM_PAGESIZE : memoryLastAddress;
+    unsigned int n = end - page;
+    unsigned int first = next < end ? LOGGER_I2C_EEPROM_PAGESIZE : n;
+    memset(bad, 0, sizeof(bad));
+    _storage->read(page, saved, first);
+    if (n > first)
+      _storage->read(next, savedNext, n - first);
+    // March C-
+    marchElement(page, end, true, -1, 0, bad, cell);
+    marchElement(page, end, true, 0, 1, bad, cell);
+    marchElement(page, end, true, 1, 0, bad, cell);
+    marchElement(page, end, false, 0, 1, bad, cell);
+    marchElement(page, end, false, 1, 0, bad, cell);
+    marchElement(page, end, true, 0, -1, bad, cell);
+    //restore previous values
+    _storage->write(page, saved, first);
+    if (n > first)
+      _storage->write(next, savedNext, n - first);
+    _storage->read(page, cell, first);
+    for (unsigned int i = 0; i < first; i++)
+    {
+      if (cell[i] != saved[i])
+        bad[i >> 3] |= 1 << (i & 7);
+    }
+    if (n > first)
+    {
+      _storage->read(next, cell, n - first);
+      for (unsigned int i = first; i < n; i++)
+      {
+        if (cell[i - first] != savedNext[i - first])
+          bad[i >> 3] |= 1 << (i & 7);
+      }
+    }
+    for (unsigned int i = 0; i < n; i++)
+    {
+      if (bad[i >> 3] & (1 << (i & 7)))
+        reportMemoryError(page + i, ++errors);
+    }
+    if ((page + n) * 10 / memoryLastAddress > progress)
+    {
+      progress = (page + n) * 10 / memoryLastAddress;
+      printMemoryTest("Memory test %: ", progress * 10L);
+    }
+  }
+  _readBlockValid = false;
+  return errors;
+}
+
+// byte j of the address line test
+static long lineAddress(uint8_t j)
+{
+  return j == 0 ? 0 : 1L << (j - 1);
+}
+
+/*
+   checkAddressLines()
+   Walking one on the address lines with the bytes at 0 and at the
+   powers of two under memoryLastAddress: a stuck or shorted address
+   line makes two of them the same byte. They are written back after
+*/
+long logger_I2C_eeprom::checkAddressLines(long memoryLastAddress)
+{
+  static const uint8_t one = 0x55;
+  static const uint8_t zero = 0xAA;
+  uint8_t saved[24];
+  uint8_t lines = 0;
+  uint8_t value;
+  long errors = 0;
+
+  while (lines < sizeof(saved) - 1 && (1L << lines) < memoryLastAddress)
+    lines++;
+  for (uint8_t j = 0; j <= lines; j++)
+    _storage->read(lineAddress(j), &saved[j], 1);
+  for (uint8_t j = 0; j <= lines; j++)
+    _storage->write(lineAddress(j), (byte*)&zero, 1);
+  for (uint8_t j = 0; j <= lines; j++)
+  {
+    long address = lineAddress(j);
+    _storage->write(address, (byte*)&one, 1);
+    for (uint8_t k = 0; k <= lines; k++)
+    {
+      if (k == j)
+        continue;
+      _storage->read(lineAddress(k), &value, 1);
+      if (value != zero)
+      {
+        reportMemoryError(address, ++errors);
+        break;
+      }
+    }
+    _storage->write(address, (byte*)&zero, 1);
+  }
+  for (uint8_t j = 0; j <= lines; j++)
+    _storage->write(lineAddress(j), &saved[j], 1);
+  return errors;
+}
+
+// this will check the memory size, in kbits
+int logger_I2C_eeprom::checkMemorySize() {
+  return (int)(probeCapacity(_capacity) / 128);
+}
+
+/*
+   probeCapacity()
+   Find the size of the eeprom without writing to it. Each chip select
+   value that answers is a 64KB block. With a single block, a smaller
+   chip ignores the high address bits so reading past its end reads its
+   start again: the windows at the start of the eeprom and one chip size
+   further are the same. A blank eeprom cannot tell, defaultCapacity is
+   used then, up to 64KB, or 64KB if it is less than the smallest eeprom.
+   The SPI memories, the ESP32 flash and the FileStorage know their size.
+   The capacity found is used by the eeprom, CanRecord() and getCapacity()
+*/
+unsigned long logger_I2C_eeprom::probeCapacity(unsigned long defaultCapacity)
+{
+  // the curve list and the start of the first curves
+  static const unsigned int probeAddress[] = {0, 100, 200, 1024, 3000};
+  unsigned long capacity = 0;
+  byte blocks = _storage->deviceCount();
+
+  // a config that was never set or is corrupt must not leave no room
+  if (defaultCapacity < LOGGER_MIN_CAPACITY)
+    defaultCapacity = 65536UL;
+
+  // a SPI memory knows its size
+  if (_storage->knowsCapacity())
+    capacity = _storage->getCapacity() > 0 ? _storage->getCapacity() : defaultCapacity;
+  else if (blocks > 1)
+    capacity = 65536UL * blocks;
+  else if (blocks == 1)
+  {
+    _storage->setCapacity(65536UL);
+    for (unsigned long size = 4096; size < 65536UL && capacity == 0; size *= 2)
+    {
+      boolean wraps = true;
+      boolean telling = false;
+      for (uint8_t i = 0; i < sizeof(probeAddress) / sizeof(probeAddress[0]); i++)
+      {
+        if (probeAddress[i] + LOGGER_PROBE_WINDOW > size)
+          break;
+        int8_t same = compareWindows(probeAddress[i], probeAddress[i] + size);
+        if (same == 0)
+        {
+          wraps = false;
+          break;
+        }
+        if (same > 0)
+          telling = true;
+      }
+      if (wraps && telling)
+        capacity = size;
+      else if (wraps)
+        // one block is 64KB at most
+        capacity = defaultCapacity < 65536UL ? defaultCapacity : 65536UL;
+    }
+    if (capacity == 0)
+      capacity = 65536UL;
+  }
+  else
+    capacity = defaultCapacity;
+
+  _storage->setCapacity(capacity);
+  _capacity = capacity;
+  return capacity;
+}
+
+/*
+   compareWindows()
+   0 if the windows differ, 1 if they are the same, -1 if they are the
+   same but all the bytes are equal so that it does not tell anything
+*/
+int8_t logger_I2C_eeprom::compareWindows(unsigned long address1, unsigned long address2)
+{
+  byte window1[LOGGER_PROBE_WINDOW];
+  byte window2[LOGGER_PROBE_WINDOW];
+  _storage->read(address1, window1, sizeof(window1));
+  _storage->read(address2, window2, sizeof(window2));
+  if (memcmp(window1, window2, sizeof(window1)) != 0)
+    return 0;
+  for (uint8_t i = 1; i < sizeof(window1); i++)
+  {
+    if (window1[i] != window1[0])
+      return 1;
+  }
+  return -1;
+}
+
+unsigned long logger_I2C_eeprom::getCapacity()
+{
+  return _capacity;
+}
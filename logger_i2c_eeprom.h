@@ -1,99 +1,304 @@
-#ifndef _LOGGER_I2C_EEPROM_H
-#define _LOGGER_I2C_EEPROM_H
-
-#include <Wire.h>
-#include "config.h"
-
-#if defined(ARDUINO) && ARDUINO >= 100
-#include "Arduino.h"
-#else
-#include "WProgram.h"
-#include "Wstring.h"
-#include "Wiring.h"
-#endif
-// TWI buffer needs max 2 bytes for eeprom address
-// 1 byte for eeprom register address is available in txbuffer
-#define I2C_TWIBUFFERSIZE  30
-
-
-struct ThrustCurveDataStruct {
-  long diffTime;
-  long thrust;
-  #if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-  long casing_pressure;
-  #endif
-
-  #if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-  long casing_pressure2;
-  long thrust_filtered;
-  #endif
-};
-
-
-struct ThrustCurveConfigStruct {
-  long ThrustCurve_start;    
-  long ThrustCurve_stop; 
-};
-
-#define LOGGER_I2C_EEPROM_VERSION "1.0.0"
-
-// The DEFAULT page size. This is overriden if you use the second constructor.
-// I2C_EEPROM_PAGESIZE must be multiple of 2 e.g. 16, 32 or 64
-// 24LC256 -> 64 bytes
-#define LOGGER_I2C_EEPROM_PAGESIZE 128 //64
-#define THRUSTCURVE_LIST_START 0
-#define THRUSTCURVE_DATA_START 200
-class logger_I2C_eeprom
-{
-public:
-    /**
-     * Initializes the EEPROM with a default pagesize of I2C_EEPROM_PAGESIZE.
-     */
-    logger_I2C_eeprom(uint8_t deviceAddress);
-    //logger_I2C_eeprom(uint8_t deviceAddress, const unsigned int deviceSize);
-    uint8_t _deviceAddress;
-    void begin();
-    void clearThrustCurveList();
-    void write_byte( unsigned long eeaddress, uint8_t data );
-    uint8_t read_byte(  unsigned long eeaddress );
-    unsigned long readThrustCurve(unsigned long eeaddress);
-    int readThrustCurveList();
-    int writeThrustCurveList();
-    int getLastThrustCurveNbr();
-    bool eraseLastThrustCurve();
-    int printThrustCurveList();
-    void setThrustCurveStartAddress(int ThrustCurveNbr, long startAddress);
-    void setThrustCurveEndAddress(int ThrustCurveNbr, long endAddress);
-    void setThrustCurveTimeData( long difftime);
-    long getThrustCurveTimeData();
-    void setThrustCurveData( long thrust);
-    long getThrustCurveData();
-    #if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-    long getPressureCurveData();
-    void setPressureCurveData( long pressure);
-    #endif
-    #if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
-    long getPressureCurveData2();
-    void setPressureCurveData2( long pressure);
-    void setThrustCurveDataFiltered( long thrust);
-    long getThrustCurveDataFiltered();
-    #endif
-    long getThrustCurveStart(int ThrustCurveNbr);
-    long getThrustCurveStop(int ThrustCurveNbr);
-    void printThrustCurveData(int ThrustCurveNbr);
-    long checkMemoryErrors(long memoryLastAddress);
-    int checkMemorySize();
-    bool checkWrite(long address);
-    boolean CanRecord();
-    unsigned long writeFastThrustCurve(unsigned long eeaddress);
-    long getSizeOfThrustCurveData();
-    long getLastThrustCurveEndAddress();   
-    
-private: 
-    ThrustCurveConfigStruct _ThrustCurveConfig[25];
-    ThrustCurveDataStruct _ThrustCurveData;
-    uint8_t _pageSize;
-};
-
-#endif
-// END OF FILE
+#ifndef _LOGGER_I2C_EEPROM_H
+#define _LOGGER_I2C_EEPROM_H
+
+#include <Wire.h>
+#include "config.h"
+#include "storage.h"
+#include <stddef.h>
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#include "Wstring.h"
+#include "Wiring.h"
+#endif
+// TWI buffer needs max 2 bytes for eeprom address
+// 1 byte for eeprom register address is available in txbuffer
+#define I2C_TWIBUFFERSIZE  30
+
+
+struct ThrustCurveDataStruct {
+  long diffTime;
+  long thrust;
+  #if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+  long casing_pressure;
+  #endif
+
+  #if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+  long casing_pressure2;
+  long thrust_filtered;
+  #endif
+  #if NBR_LOADCELLS > 1
+  long thrust_channel[NBR_LOADCELLS - 1]; // load cells 2 and up
+  #endif
+};
+
+
+struct ThrustCurveConfigStruct {
+  long ThrustCurve_start;    // the high byte is the storage format
+  long ThrustCurve_stop; 
+};
+
+// record indexes of the trigger and of the end of the burn, -1 if none
+struct ThrustCurveMarksStruct {
+  long triggerRecord;
+  long stopRecord;
+};
+
+// storage format of a curve
+// raw: one ThrustCurveDataStruct per sample followed by a spare byte
+// compact: a length byte then each field of ThrustCurveDataStruct as a
+// zigzag varint, the difference with the previous record or the value
+// itself in a keyframe
+// header: the curve starts with a ThrustCurveHeaderStruct and the records
+// only hold the fields of its channels, 4 bytes each if not compact
+#define THRUSTCURVE_FORMAT_RAW 0
+#define THRUSTCURVE_FORMAT_COMPACT 1
+#define THRUSTCURVE_FORMAT_MASK 0x0F
+#define THRUSTCURVE_FORMAT_HEADER 0x10
+#define THRUSTCURVE_FORMAT_SHIFT 24
+#define THRUSTCURVE_ADDRESS_MASK 0x00FFFFFFL
+#define THRUSTCURVE_FIELDS (sizeof(ThrustCurveDataStruct) / sizeof(long))
+#define THRUSTCURVE_VARINT_MAX ((sizeof(long) * 8 + 6) / 7)
+#define THRUSTCURVE_COMPACT_MAX (1 + THRUSTCURVE_FIELDS * THRUSTCURVE_VARINT_MAX)
+// a keyframe every so many compact records so that a bad byte does not
+// spoil the rest of the curve
+#define THRUSTCURVE_KEYFRAME_INTERVAL 32
+#define THRUSTCURVE_KEYFRAME 0x80
+
+// channels of a curve, in the order of the fields in a record
+#define THRUSTCURVE_CH_TIME 0x01            // diffTime, else one record per sample clock tick
+#define THRUSTCURVE_CH_THRUST 0x02
+#define THRUSTCURVE_CH_PRESSURE 0x04
+#define THRUSTCURVE_CH_PRESSURE2 0x08
+#define THRUSTCURVE_CH_THRUST_FILTERED 0x10
+#define THRUSTCURVE_CH_LOADCELL2 0x20       // load cells 2 to 4
+#define THRUSTCURVE_CH_ALL 0xFF
+// version 2 adds triggerTime
+#define THRUSTCURVE_HEADER_VERSION 2
+
+struct ThrustCurveHeaderStruct {
+  uint8_t version;
+  uint8_t unit;
+  uint8_t channels;         // THRUSTCURVE_CH_ of the fields stored in each record
+  uint8_t spare;
+  long samplePeriod;        // us between two records
+  long calibration_factor;
+  long current_offset;
+  long triggerTime;         // ms from the first record to the trigger, the records before it are pre-trigger
+};
+// version 1 headers stop before triggerTime
+#define THRUSTCURVE_HEADER_V1_SIZE offsetof(ThrustCurveHeaderStruct, triggerTime)
+
+#define LOGGER_I2C_EEPROM_VERSION "1.0.0"
+
+// The DEFAULT page size. This is overriden if you use the second constructor.
+// I2C_EEPROM_PAGESIZE must be multiple of 2 e.g. 16, 32 or 64
+// 24LC256 -> 64 bytes
+// 24LC512 -> 128 bytes
+// the records are staged in RAM and written one page at a time, one page
+// is filled while the previous one is written
+#define LOGGER_I2C_EEPROM_PAGESIZE 128 //64
+// page of the eeprom chip, a write cycle never crosses one. 64 bytes
+// fits the 24LC128 to the 24LC512, the eeprom drops to 32 bytes when the
+// probe finds a 24LC32 or 24LC64. A staged page takes two write cycles
+#define LOGGER_EEPROM_CHIP_PAGESIZE 64
+// the dumps read the eeprom in aligned blocks as large as one Wire
+// transaction allows, so a block never crosses a page
+#if BUFFER_LENGTH >= LOGGER_I2C_EEPROM_PAGESIZE
+#define LOGGER_READ_BLOCK LOGGER_I2C_EEPROM_PAGESIZE
+#elif BUFFER_LENGTH >= 64
+#define LOGGER_READ_BLOCK 64
+#else
+#define LOGGER_READ_BLOCK 32
+#endif
+// stop recording that close to the end of the eeprom
+#define THRUSTCURVE_FULL_MARGIN 36
+// bytes compared by the wraparound probe
+#define LOGGER_PROBE_WINDOW 32
+// smallest eeprom the probe accepts, the 24LC32
+#define LOGGER_MIN_CAPACITY 4096UL
+// failing addresses printed by the memory test
+#define LOGGER_TEST_REPORT_MAX 16
+#define THRUSTCURVE_LIST_START 0
+#define THRUSTCURVE_DATA_START 200
+
+// curve directory
+// An append-only log of 8 byte entries growing down from the end of the
+// eeprom: a BEGIN entry in the last 8 bytes, then for each curve a START
+// entry and a COMMIT entry with its end address, or an ERASE entry that
+// drops the last curve. MARK entries between the START and the COMMIT
+// give the record indexes of the trigger and of the end of the burn.
+// An entry is only written once so a power loss
+// can at worst leave the curve being recorded open, it is then closed at
+// its last checkpoint when the list is read.
+// The old 25 curve list at THRUSTCURVE_LIST_START is moved to the log the
+// first time, its room then holds the checkpoints of the curve being
+// recorded.
+#define THRUSTCURVE_LOG_BEGIN 'B'
+#define THRUSTCURVE_LOG_START 'S'
+#define THRUSTCURVE_LOG_COMMIT 'C'
+#define THRUSTCURVE_LOG_ERASE 'E'
+#define THRUSTCURVE_LOG_CHECKPOINT 'P'
+#define THRUSTCURVE_LOG_MARK 'M'
+// format byte of a MARK entry, what its record index is
+#define THRUSTCURVE_MARK_TRIGGER 'T'
+#define THRUSTCURVE_MARK_STOP 'O'
+// entries left free between the data and the log for the next curve
+#define THRUSTCURVE_LOG_SPARE 16
+#define THRUSTCURVE_CHECKPOINTS 25
+#define THRUSTCURVE_CHECKPOINT_MS 1000
+// curves of the directory kept in RAM
+#define THRUSTCURVE_CACHE 25
+
+struct ThrustCurveLogEntry {
+  uint8_t type;
+  uint8_t generation;       // changed each time the list is cleared
+  uint8_t seq;              // low byte of the slot, or of the START slot for a checkpoint
+  uint8_t format;
+  uint8_t address[3];
+  uint8_t check;
+};
+class logger_I2C_eeprom
+{
+public:
+    /**
+     * Initializes the EEPROM with a default pagesize of I2C_EEPROM_PAGESIZE.
+     */
+    logger_I2C_eeprom(uint8_t deviceAddress);
+    //logger_I2C_eeprom(uint8_t deviceAddress, const unsigned int deviceSize);
+    uint8_t _deviceAddress;
+    byte begin();
+    void setStorage(StorageDevice &device);
+    void clearThrustCurveList();
+    void write_byte( unsigned long eeaddress, uint8_t data );
+    uint8_t read_byte(  unsigned long eeaddress );
+    unsigned long readThrustCurve(unsigned long eeaddress);
+    unsigned long readCompactThrustCurve(unsigned long eeaddress);
+    unsigned long readPackedThrustCurve(unsigned long eeaddress);
+    unsigned long readThrustCurveHeader(unsigned long eeaddress);
+    unsigned long writeThrustCurveHeader(int ThrustCurveNbr, unsigned long eeaddress, uint8_t channels, long samplePeriod, int unit, long calibration_factor, long current_offset, long triggerTime);
+    int getRecordsForSample(long diffTime);
+    int readThrustCurveList();
+    int writeThrustCurveList();
+    int getLastThrustCurveNbr();
+    bool eraseLastThrustCurve();
+    int printThrustCurveList();
+    void checkpointThrustCurve();
+    long getThrustCurveRecords();
+    void setThrustCurveMarks(long triggerRecord, long stopRecord);
+    void getThrustCurveMarks(int ThrustCurveNbr, long &triggerRecord, long &stopRecord);
+    long getDataEnd();
+    long getNextCurveStart();
+    void setThrustCurveStartAddress(int ThrustCurveNbr, long startAddress);
+    void setThrustCurveEndAddress(int ThrustCurveNbr, long endAddress);
+    void setThrustCurveFormat(int ThrustCurveNbr, int format);
+    int getThrustCurveFormat(int ThrustCurveNbr);
+    void setThrustCurveTimeData( long difftime);
+    long getThrustCurveTimeData();
+    void setThrustCurveData( long thrust);
+    long getThrustCurveData();
+    #if defined TESTSTANDSTM32V2 || defined TESTSTANDESP32 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    long getPressureCurveData();
+    void setPressureCurveData( long pressure);
+    #endif
+    #if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+    long getPressureCurveData2();
+    void setPressureCurveData2( long pressure);
+    void setThrustCurveDataFiltered( long thrust);
+    long getThrustCurveDataFiltered();
+    #endif
+    #if NBR_LOADCELLS > 1
+    void setThrustCurveDataChannel(int channel, long thrust);
+    long getThrustCurveDataChannel(int channel);
+    #endif
+    long getThrustCurveStart(int ThrustCurveNbr);
+    long getThrustCurveStop(int ThrustCurveNbr);
+    void printThrustCurveData(int ThrustCurveNbr);
+    void printThrustCurveHeader(int ThrustCurveNbr);
+    long checkMemoryErrors(long memoryLastAddress);
+    int checkMemorySize();
+    unsigned long probeCapacity(unsigned long defaultCapacity);
+    unsigned long getCapacity();
+    boolean CanRecord();
+    unsigned long writeFastThrustCurve(unsigned long eeaddress);
+    void flushThrustCurve();
+    boolean poll();
+    long getWriteErrors();
+    long getSizeOfThrustCurveData();
+    long getLastThrustCurveEndAddress();   
+    
+private: 
+    StorageDevice *_storage;
+    // what open() returned, 0 if the memory answered
+    byte _storageStatus;
+    // curves _curveBase and up of the directory
+    ThrustCurveConfigStruct _ThrustCurveConfig[THRUSTCURVE_CACHE];
+    ThrustCurveMarksStruct _ThrustCurveMarks[THRUSTCURVE_CACHE];
+    int _curveBase;
+    int _curveCount;
+    long _lastEnd;
+    unsigned int _logSlots;
+    uint8_t _generation;
+    // curve being recorded, in the log once _openSlot is set
+    boolean _curveOpen;
+    long _openStart;
+    long _openEnd;
+    int _openFormat;
+    unsigned int _openSlot;
+    long _durableEnd;
+    // records written and record indexes of the trigger and the burnout,
+    // -1 when there is none
+    unsigned long _writeCount;
+    long _openTrigger;
+    long _openStop;
+    // flash blocks erased ahead of the curve
+    unsigned long _erasedTo;
+    unsigned long _eraseAhead;
+    uint8_t _checkpointSlot;
+    long logSlotAddress(unsigned int slot);
+    boolean readLogEntry(unsigned int slot, ThrustCurveLogEntry &entry);
+    void writeLogEntry(unsigned int slot, uint8_t type, uint8_t format, long address);
+    int scanLog(int base, unsigned int &openSlot);
+    int findThrustCurve(int ThrustCurveNbr);
+    long lastCheckpoint(unsigned int openSlot, long openStart);
+    void migrateThrustCurveList();
+    ThrustCurveDataStruct _ThrustCurveData;
+    uint8_t _pageSize;
+    // page being filled by writeFastThrustCurve() and page being written
+    uint8_t _stageBuffer[2][LOGGER_I2C_EEPROM_PAGESIZE];
+    uint8_t *_stage;
+    unsigned long _stagePage;
+    uint16_t _stageFrom;
+    uint16_t _stageTo;
+    boolean _writePending;
+    long _writeErrors;
+    void writeStagedPage();
+    unsigned long stageBytes(unsigned long eeaddress, byte *values, unsigned int nBytes);
+    // compact format state, last record written or read
+    int _writeFormat;
+    int _readFormat;
+    long _compactData[THRUSTCURVE_FIELDS];
+    unsigned int _compactCount;
+    // fields of the records of the curve being written or read
+    ThrustCurveHeaderStruct _ThrustCurveHeader;
+    uint8_t _fields[THRUSTCURVE_FIELDS];
+    uint8_t _nbrFields;
+    unsigned long _readCount;
+    uint8_t setFields(uint8_t channels);
+    void implicitTime();
+    // read-ahead block for the dumps
+    uint8_t _readBlock[LOGGER_READ_BLOCK];
+    unsigned long _readBlockAddr;
+    boolean _readBlockValid;
+    void readCached(unsigned long eeaddress, byte *values, unsigned int nBytes);
+    unsigned long _capacity;
+    int8_t compareWindows(unsigned long address1, unsigned long address2);
+    long checkAddressLines(long memoryLastAddress);
+    void reportMemoryError(long address, long errors);
+    void marchElement(long start, long end, boolean up, int8_t expect, int8_t write, uint8_t *bad, uint8_t *cell);
+};
+
+#endif
+// END OF FILE
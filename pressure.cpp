@@ -0,0 +1,136 @@
+#include "pressure.h"
+
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+// psi = (rawQ4 * gain + offset) >> PRESSURE_FRAC_BITS
+static int64_t pressureGain[PRESSURE_CHANNELS];
+static int64_t pressureOffset[PRESSURE_CHANNELS];
+KalmanFilter pressureFilter[PRESSURE_CHANNELS];
+
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+// ESP32 ADC linearization, adjusted value in 1/16 of a count for each raw count
+static uint16_t adcLinearTable[4096];
+static boolean adcLinearTableReady = false;
+
+static void buildAdcLinearTable()
+{
+  // Specify the adjustment factors.
+  const double f[12] = {
+    1.7111361460487501e+001,
+    4.2319467860421662e+000,
+    -1.9077375643188468e-002,
+    5.4338055402459246e-005,
+    -8.7712931081088873e-008,
+    8.7526709101221588e-011,
+    -5.6536248553232152e-014,
+    2.4073049082147032e-017,
+    -6.7106284580950781e-021,
+    1.1781963823253708e-024,
+    -1.1818752813719799e-028,
+    5.1642864552256602e-033
+  };
+
+  for (int raw = 0; raw < 4096; raw++) {
+    // Horner form of f[0] + f[1] * raw + ... + f[11] * raw^11
+    double adjusted = f[11];
+    for (int i = 10; i >= 0; i--)
+      adjusted = adjusted * raw + f[i];
+
+    adjusted *= 16;
+    if (adjusted < 0)
+      adjusted = 0;
+    if (adjusted > 65535)
+      adjusted = 65535;
+    adcLinearTable[raw] = (uint16_t)(adjusted + 0.5);
+  }
+  adcLinearTableReady = true;
+}
+
+/*
+   analogReadAdjusted()
+   Average of 40 linearized reads, in 1/16 of an ADC count
+*/
+long analogReadAdjusted(byte pinNumber)
+{
+  const int loops = 40;
+  long total = 0;
+
+  for (int counter = 0; counter < loops; counter++)
+    total += adcLinearTable[analogRead(pinNumber) & 0x0FFF];
+
+  return total / loops;
+}
+#endif
+
+int pressureSensorTypeToMaxValue( int type) {
+  //"100 PSI", "150 PSI", "200 PSI", "300 PSI", "500 PSI", "1000 PSI", "1600 PSI"
+  int maxValue = 100;
+  switch (type)
+  {
+    case 0:
+      maxValue = 100;
+      break;
+    case 1:
+      maxValue = 100;
+      break;
+    case 2:
+      maxValue = 150;
+      break;
+    case 3:
+      maxValue = 200;
+      break;
+    case 4:
+      maxValue = 300;
+      break;
+    case 5:
+      maxValue = 500;
+      break;
+    case 6:
+      maxValue = 1000;
+      break;
+    case 7:
+      maxValue = 1600;
+      break;
+  }
+
+  return maxValue;
+}
+
+/*
+   buildPressureConversion()
+   The sensors give 0.5V at 0 PSI and 4.5V at full scale, through the
+   VOLT_DIVIDER_PRESSURE divider, on a 12 bit 3.3V ADC
+*/
+void buildPressureConversion()
+{
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  if (!adcLinearTableReady)
+    buildAdcLinearTable();
+#endif
+
+  for (uint8_t channel = 0; channel < PRESSURE_CHANNELS; channel++) {
+    int type = config.pressure_sensor_type;
+#if PRESSURE_CHANNELS > 1
+    if (channel == 1)
+      type = config.pressure_sensor_type2;
+#endif
+    double maxValue = pressureSensorTypeToMaxValue(type);
+    double voltPerCount = 3.3 / 4096.0 / 16.0 / VOLT_DIVIDER_PRESSURE;
+    double gain = voltPerCount * maxValue / (4.5 - 0.5);
+    double offset = -0.5 * maxValue / (4.5 - 0.5);
+
+    pressureGain[channel] = (int64_t)(gain * (1L << PRESSURE_FRAC_BITS) + 0.5);
+    pressureOffset[channel] = (int64_t)(offset * (1L << PRESSURE_FRAC_BITS) - 0.5);
+  }
+}
+
+/*
+   pressureFromRaw()
+   rawQ4 is in 1/16 of an ADC count, the result is truncated toward 0
+   like the (long) cast of the float code it replaces
+*/
+long pressureFromRaw(uint8_t channel, long rawQ4)
+{
+  int64_t value = (int64_t)rawQ4 * pressureGain[channel] + pressureOffset[channel];
+  return (long)(value / (1L << PRESSURE_FRAC_BITS));
+}
+#endif
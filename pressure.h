@@ -0,0 +1,37 @@
+#ifndef _PRESSURE_H
+#define _PRESSURE_H
+/*
+   Conversion of the raw pressure readings to PSI
+
+   The coefficients are worked out from the config once, by
+   buildPressureConversion(), when the config is read or written.
+   A reading then only costs one multiply-add.
+   Raw readings are in 1/16 of an ADC count so that averaged values
+   keep their fractional part.
+*/
+#include "config.h"
+#include "Arduino.h"
+#include "kalman.h"
+
+#if defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+
+#if defined TESTSTANDSTM32V3 || defined TESTSTANDESP32V3
+#define PRESSURE_CHANNELS 2
+#else
+#define PRESSURE_CHANNELS 1
+#endif
+
+// fixed point scale of the coefficients
+#define PRESSURE_FRAC_BITS 24
+
+extern void buildPressureConversion();
+extern long pressureFromRaw(uint8_t channel, long rawQ4);
+extern int pressureSensorTypeToMaxValue(int type);
+// one Kalman filter per channel
+extern KalmanFilter pressureFilter[PRESSURE_CHANNELS];
+
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+extern long analogReadAdjusted(byte pinNumber);
+#endif
+#endif
+#endif
@@ -0,0 +1,111 @@
+#ifndef _RINGBUFFER_H
+#define _RINGBUFFER_H
+/*
+   Single producer / single consumer lock free ring buffer
+
+   One side (an interrupt routine, a timer callback or a task) only calls
+   push() while the other side only calls pop(), so no lock is needed.
+   The indexes are single bytes so that they are read and written
+   atomically on the Atmega 328 as well.
+   SIZE must be a power of 2 and no more than 256.
+*/
+#include "Arduino.h"
+
+#if defined ESP32 || defined ARDUINO_ARCH_ESP32
+// producer and consumer can run on different cores
+#define RINGBUFFER_BARRIER() __sync_synchronize()
+// inlined in the producer, an IRAM interrupt routine must not call into
+// the flash
+#define RINGBUFFER_PUSH_ATTR __attribute__((always_inline))
+#else
+#define RINGBUFFER_BARRIER() __asm__ __volatile__("" ::: "memory")
+#define RINGBUFFER_PUSH_ATTR
+#endif
+
+template <typename T, uint16_t SIZE>
+class RingBuffer
+{
+public:
+  RingBuffer()
+  {
+    _head = 0;
+    _tail = 0;
+    _overruns = 0;
+  }
+
+  // producer side
+  // return false and count an overrun if the buffer is full
+  RINGBUFFER_PUSH_ATTR bool push(const T &item)
+  {
+    uint8_t head = _head;
+    uint8_t next = (uint8_t)((head + 1) & (SIZE - 1));
+    if (next == _tail)
+    {
+      _overruns++;
+      return false;
+    }
+    _items[head] = item;
+    RINGBUFFER_BARRIER();
+    _head = next;
+    return true;
+  }
+
+  // consumer side
+  bool pop(T &item)
+  {
+    uint8_t tail = _tail;
+    if (tail == _head)
+      return false;
+    RINGBUFFER_BARRIER();
+    item = _items[tail];
+    RINGBUFFER_BARRIER();
+    _tail = (uint8_t)((tail + 1) & (SIZE - 1));
+    return true;
+  }
+
+  // consumer side, look at the oldest item without removing it
+  bool peek(T &item)
+  {
+    uint8_t tail = _tail;
+    if (tail == _head)
+      return false;
+    RINGBUFFER_BARRIER();
+    item = _items[tail];
+    return true;
+  }
+
+  // consumer side, drop everything queued so far
+  void clear()
+  {
+    _tail = _head;
+  }
+
+  uint8_t available()
+  {
+    return (uint8_t)((_head - _tail) & (SIZE - 1));
+  }
+
+  bool isEmpty()
+  {
+    return _head == _tail;
+  }
+
+  uint16_t getOverruns()
+  {
+    return _overruns;
+  }
+
+  void resetOverruns()
+  {
+    _overruns = 0;
+  }
+
+private:
+  static_assert((SIZE & (SIZE - 1)) == 0 && SIZE >= 2 && SIZE <= 256, "RingBuffer SIZE must be a power of 2 up to 256");
+  T _items[SIZE];
+  volatile uint8_t _head;
+  volatile uint8_t _tail;
+  volatile uint16_t _overruns;
+};
+
+#endif
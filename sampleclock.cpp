@@ -0,0 +1,226 @@
+#include "sampleclock.h"
+
+static volatile unsigned long sampleTicks = 0;
+static unsigned long servedTicks = 0;
+static unsigned long samplePeriodUs = 0;
+static unsigned long sampleStartMicros = 0;
+// micros() and the ticks already counted when there is no timer
+static unsigned long baseMicros = 0;
+static unsigned long baseTicks = 0;
+static unsigned int sampleRate = 0;
+static boolean clockRunning = false;
+static unsigned long sumLateUs = 0;
+static SampleClockStats clockStats;
+
+#ifdef TESTSTAND
+ISR(TIMER1_COMPA_vect)
+{
+  sampleTicks++;
+}
+#endif
+
+#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+static HardwareTimer *sampleTimer = NULL;
+
+static void onSampleTimer()
+{
+  sampleTicks++;
+}
+#endif
+
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+static esp_timer_handle_t sampleTimer = NULL;
+// task blocked in sampleClockWait()
+static volatile TaskHandle_t waitingTask = NULL;
+
+static void onSampleTimer(void *arg)
+{
+  sampleTicks++;
+  TaskHandle_t task = waitingTask;
+  if (task != NULL)
+    xTaskNotifyGive(task);
+}
+#endif
+
+/*
+   sampleRateFromResolution()
+   standResolution 0 to 3 gives 10 to 40 samples per second,
+   anything above is taken as a rate in Hz
+*/
+unsigned int sampleRateFromResolution(int standResolution)
+{
+  unsigned int hz;
+  if (standResolution <= 3)
+    hz = 10 * (standResolution + 1);
+  else
+    hz = standResolution;
+  if (hz < SAMPLE_CLOCK_MIN_HZ)
+    hz = SAMPLE_CLOCK_MIN_HZ;
+  if (hz > SAMPLE_CLOCK_MAX_HZ)
+    hz = SAMPLE_CLOCK_MAX_HZ;
+  return hz;
+}
+
+static unsigned long readTicks()
+{
+#ifdef TESTSTAND
+  // 32 bits are not read atomically on the Atmega
+  noInterrupts();
+  unsigned long ticks = sampleTicks;
+  interrupts();
+  return ticks;
+#elif defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3 || defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  return sampleTicks;
+#else
+  // no timer on this board, derive the ticks from micros(). The base
+  // follows the ticks so that micros() - baseMicros never wraps.
+  unsigned long n = (micros() - baseMicros) / samplePeriodUs;
+  baseMicros += n * samplePeriodUs;
+  baseTicks += n;
+  return baseTicks;
+#endif
+}
+
+/*
+   sampleClockStart()
+   start ticking at hz, resets the statistics
+*/
+boolean sampleClockStart(unsigned int hz)
+{
+  if (hz < SAMPLE_CLOCK_MIN_HZ || hz > SAMPLE_CLOCK_MAX_HZ)
+    return false;
+
+  sampleClockStop();
+  clockRunning = true;
+  sampleRate = hz;
+  samplePeriodUs = 1000000UL / hz;
+  sampleTicks = 0;
+  servedTicks = 0;
+  sumLateUs = 0;
+  clockStats.ticks = 0;
+  clockStats.overruns = 0;
+  clockStats.maxLateUs = 0;
+  clockStats.meanLateUs = 0;
+  sampleStartMicros = micros();
+  baseMicros = sampleStartMicros;
+  baseTicks = 0;
+
+#ifdef TESTSTAND
+  // Timer1 in CTC mode, 16MHz / 64 = 250kHz so 4Hz fits in OCR1A
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = 0;
+  TCNT1 = 0;
+  OCR1A = (uint16_t)((F_CPU / 64UL) / hz - 1);
+  TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+  TIMSK1 |= _BV(OCIE1A);
+  interrupts();
+#endif
+
+#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+  if (sampleTimer == NULL)
+    sampleTimer = new HardwareTimer(TIM4);
+  sampleTimer->setOverflow(hz, HERTZ_FORMAT);
+  sampleTimer->attachInterrupt(onSampleTimer);
+  sampleTimer->resume();
+#endif
+
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  if (sampleTimer == NULL) {
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &onSampleTimer;
+    timerArgs.name = "sampleclock";
+    if (esp_timer_create(&timerArgs, &sampleTimer) != ESP_OK)
+      return false;
+  }
+  esp_timer_start_periodic(sampleTimer, samplePeriodUs);
+#endif
+  return true;
+}
+
+void sampleClockStop()
+{
+  if (!clockRunning)
+    return;
+#ifdef TESTSTAND
+  TIMSK1 &= ~_BV(OCIE1A);
+  TCCR1B = 0;
+#endif
+#if defined TESTSTANDSTM32 || defined TESTSTANDSTM32V2 || defined TESTSTANDSTM32V3
+  sampleTimer->pause();
+  sampleTimer->detachInterrupt();
+#endif
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+  esp_timer_stop(sampleTimer);
+#endif
+  clockRunning = false;
+}
+
+/*
+   sampleClockWait()
+   block until the next tick and return its number, the first tick is 1.
+   If more than one tick went by since the last call the missing ones
+   are counted as overruns.
+*/
+unsigned long sampleClockWait()
+{
+  unsigned long ticks = readTicks();
+  while (ticks == servedTicks) {
+#if defined TESTSTANDESP32 || defined TESTSTANDESP32V3
+    // sleep until the timer notifies us so that a high priority
+    // acquisition task does not starve the idle task of its core
+    waitingTask = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+#else
+    yield();
+#endif
+    ticks = readTicks();
+  }
+
+  // how late are we on the ideal time of this tick, both sides wrap
+  // after 71 minutes but their difference does not
+  long late = (long)((micros() - sampleStartMicros) - ticks * samplePeriodUs);
+  if (late < 0)
+    late = 0;
+  if ((unsigned long)late > clockStats.maxLateUs)
+    clockStats.maxLateUs = late;
+  sumLateUs += late;
+
+  clockStats.overruns += ticks - servedTicks - 1;
+  clockStats.ticks++;
+  servedTicks = ticks;
+  return ticks;
+}
+
+/*
+   sampleClockDue()
+   true if a tick is waiting to be served, so that the time left before
+   it can be used for something else than waiting
+*/
+boolean sampleClockDue()
+{
+  return readTicks() != servedTicks;
+}
+
+/*
+   sampleClockMillis()
+   time of a tick in ms from the start of the clock. tick * samplePeriodUs
+   would wrap after 71 minutes, as when the stand stays armed, this
+   only wraps after 49 days like millis() so the differences of two
+   times stay right
+*/
+unsigned long sampleClockMillis(unsigned long tick)
+{
+  return (tick / 1000) * samplePeriodUs + ((tick % 1000) * samplePeriodUs) / 1000;
+}
+
+unsigned int sampleClockRate()
+{
+  return sampleRate;
+}
+
+void sampleClockGetStats(SampleClockStats &stats)
+{
+  clockStats.meanLateUs = clockStats.ticks > 0 ? sumLateUs / clockStats.ticks : 0;
+  stats = clockStats;
+}
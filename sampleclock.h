@@ -0,0 +1,32 @@
+#ifndef _SAMPLECLOCK_H
+#define _SAMPLECLOCK_H
+/*
+   Fixed rate sampling clock
+
+   A hardware timer ticks at the sample rate and the recorder waits for
+   each tick, so the records sit on a uniform time grid whatever the time
+   taken by the eeprom or the telemetry.
+   Atmega 328: Timer1, STM32: HardwareTimer on TIM4, ESP32: esp_timer
+*/
+#include "config.h"
+#include "Arduino.h"
+
+#define SAMPLE_CLOCK_MIN_HZ 4
+#define SAMPLE_CLOCK_MAX_HZ 1000
+
+struct SampleClockStats {
+  unsigned long ticks;        // ticks served
+  unsigned long overruns;     // ticks missed because a sample took too long
+  unsigned long maxLateUs;    // worst delay between a tick and its service
+  unsigned long meanLateUs;
+};
+
+extern unsigned int sampleRateFromResolution(int standResolution);
+extern boolean sampleClockStart(unsigned int hz);
+extern void sampleClockStop();
+extern unsigned long sampleClockWait();
+extern boolean sampleClockDue();
+extern unsigned long sampleClockMillis(unsigned long tick);
+extern unsigned int sampleClockRate();
+extern void sampleClockGetStats(SampleClockStats &stats);
+#endif
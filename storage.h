@@ -0,0 +1,52 @@
+#ifndef _STORAGE_H
+#define _STORAGE_H
+/*
+   StorageDevice
+   What the logger needs from the memory the thrust curves are written to:
+   the I2C eeprom (extEEPROM, an I2C FRAM works with it too), a SPI FRAM,
+   a SPI NOR flash, a partition of the ESP32 flash or a file when the
+   logger is built on a computer.
+
+   write() and writeAsync() are given at most one page of the logger,
+   LOGGER_I2C_EEPROM_PAGESIZE bytes, and never across one. writeAsync()
+   returns at once and poll() moves the write forward, it returns
+   STORAGE_BUSY until the write is done then its status.
+   A memory that must be erased before it is written gives the size of its
+   erase blocks in getEraseSize(), the logger erases each block before its
+   first write. It is 1 for the others.
+   A driver may keep what writeAsync() is given in RAM until sync(),
+   write() is always in the memory when it returns.
+*/
+#include <stdint.h>
+
+//address past the end of the memory
+#define STORAGE_ADDR_ERR 9
+//returned by writeAsync() and poll() while a write or an erase is in progress
+#define STORAGE_BUSY 10
+//the write or the erase did not end in time
+#define STORAGE_TIMEOUT 11
+
+class StorageDevice
+{
+  public:
+    //called by logger_I2C_eeprom::begin(), 0 if the memory answered
+    virtual uint8_t open() { return 0; }
+    virtual uint8_t read(unsigned long addr, uint8_t *values, unsigned int nBytes) = 0;
+    virtual uint8_t write(unsigned long addr, uint8_t *values, unsigned int nBytes) = 0;
+    virtual uint8_t writeAsync(unsigned long addr, uint8_t *values, unsigned int nBytes) = 0;
+    virtual uint8_t poll() = 0;
+    virtual bool isBusy() = 0;
+    virtual void waitReady() = 0;
+    virtual uint8_t sync() { return 0; }
+    //erase the block that holds addr, the next write waits for it
+    virtual uint8_t erase(unsigned long addr) { return 0; }
+    virtual unsigned long getEraseSize() { return 1; }
+    //false when the logger has to find the size of the memory, from the
+    //chips answering on the bus and the address wraparound
+    virtual bool knowsCapacity() { return true; }
+    virtual uint8_t deviceCount() { return 1; }
+    virtual void setCapacity(unsigned long capacity) = 0;
+    virtual unsigned long getCapacity() = 0;
+};
+
+#endif
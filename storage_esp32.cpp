@@ -0,0 +1,153 @@
+#include "storage_esp32.h"
+
+#if defined STORAGE_ESP32_FLASH && (defined TESTSTANDESP32 || defined TESTSTANDESP32V3)
+
+ESP32FlashStorage::ESP32FlashStorage(const char *label)
+{
+  _label = label;
+  _partition = NULL;
+  _capacity = 0;
+  _sectorAddr = 0;
+  _dirtyFrom = 0;
+  _dirtyTo = 0;
+  _syncPending = false;
+  _status = 0;
+}
+
+byte ESP32FlashStorage::open()
+{
+  _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, _label);
+  if (_partition == NULL)
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
+  if (_partition == NULL)
+    return 2;
+  _capacity = _partition->size < ESP32_FLASH_MAX_CAPACITY ? _partition->size : ESP32_FLASH_MAX_CAPACITY;
+  return 0;
+}
+
+byte ESP32FlashStorage::read(unsigned long addr, byte *values, unsigned int nBytes)
+{
+  if (_partition == NULL || addr + nBytes > _capacity)
+    return STORAGE_ADDR_ERR;
+  if (esp_partition_read(_partition, addr, values, nBytes) != ESP_OK)
+    return 4;
+  // the bytes still in the sector buffer
+  if (_dirtyTo > _dirtyFrom)
+  {
+    unsigned long from = _sectorAddr + _dirtyFrom;
+    unsigned long to = _sectorAddr + _dirtyTo;
+    unsigned long first = addr > from ? addr : from;
+    unsigned long last = addr + nBytes < to ? addr + nBytes : to;
+    if (first < last)
+      memcpy(values + (first - addr), _sector + (first - _sectorAddr), last - first);
+  }
+  return 0;
+}
+
+/*
+   writeAsync()
+   copy the bytes in the sector buffer. It holds one run of bytes, the
+   buffer is written first if they do not follow it
+*/
+byte ESP32FlashStorage::writeAsync(unsigned long addr, byte *values, unsigned int nBytes)
+{
+  if (_partition == NULL || addr + nBytes > _capacity)
+    return STORAGE_ADDR_ERR;
+  while (nBytes > 0)
+  {
+    unsigned long sector = addr & ~(ESP32_FLASH_SECTOR - 1UL);
+    uint16_t offset = addr - sector;
+    uint16_t n = ESP32_FLASH_SECTOR - offset < nBytes ? ESP32_FLASH_SECTOR - offset : nBytes;
+    if (_dirtyTo > _dirtyFrom && (sector != _sectorAddr || offset != _dirtyTo))
+    {
+      byte status = sync();
+      if (status != 0)
+        return status;
+    }
+    if (_dirtyTo == _dirtyFrom)
+    {
+      _sectorAddr = sector;
+      _dirtyFrom = offset;
+    }
+    memcpy(_sector + offset, values, n);
+    _dirtyTo = offset + n;
+    addr += n;
+    values += n;
+    nBytes -= n;
+  }
+  // a full sector is written by the next poll()
+  _syncPending = _dirtyTo == ESP32_FLASH_SECTOR;
+  return 0;
+}
+
+byte ESP32FlashStorage::write(unsigned long addr, byte *values, unsigned int nBytes)
+{
+  byte status = writeAsync(addr, values, nBytes);
+  if (status != 0)
+    return status;
+  return sync();
+}
+
+byte ESP32FlashStorage::poll()
+{
+  if (_syncPending)
+    return sync();
+  return _status;
+}
+
+bool ESP32FlashStorage::isBusy()
+{
+  return false;
+}
+
+void ESP32FlashStorage::waitReady()
+{
+  poll();
+}
+
+byte ESP32FlashStorage::sync()
+{
+  _syncPending = false;
+  if (_dirtyTo > _dirtyFrom)
+  {
+    esp_err_t err = esp_partition_write(_partition, _sectorAddr + _dirtyFrom, _sector + _dirtyFrom, _dirtyTo - _dirtyFrom);
+    _status = err == ESP_OK ? 0 : 4;
+  }
+  _dirtyFrom = 0;
+  _dirtyTo = 0;
+  return _status;
+}
+
+byte ESP32FlashStorage::erase(unsigned long addr)
+{
+  unsigned long sector = addr & ~(ESP32_FLASH_SECTOR - 1UL);
+  if (_partition == NULL || addr >= _capacity)
+    return STORAGE_ADDR_ERR;
+  // what is left to write there is erased too
+  if (_dirtyTo > _dirtyFrom && _sectorAddr == sector)
+  {
+    _dirtyFrom = 0;
+    _dirtyTo = 0;
+    _syncPending = false;
+  }
+  if (esp_partition_erase_range(_partition, sector, ESP32_FLASH_SECTOR) != ESP_OK)
+    return 4;
+  return 0;
+}
+
+unsigned long ESP32FlashStorage::getEraseSize()
+{
+  return ESP32_FLASH_SECTOR;
+}
+
+void ESP32FlashStorage::setCapacity(unsigned long capacity)
+{
+  _capacity = capacity;
+}
+
+unsigned long ESP32FlashStorage::getCapacity()
+{
+  return _capacity;
+}
+
+#endif
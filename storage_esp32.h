@@ -0,0 +1,61 @@
+#ifndef _STORAGE_ESP32_H
+#define _STORAGE_ESP32_H
+/*
+   ESP32FlashStorage
+   A data partition of the ESP32 flash, the one labelled "curves" or else
+   the spiffs partition of the default partition scheme, which the test
+   stand does not use otherwise.
+   The records are gathered in a sector buffer and written to the flash
+   when the sector is full, from poll(), or on sync(). The flash is read
+   through the buffer so the dumps see the records not yet written.
+   Writing or erasing the flash turns the caches off on both cores, so
+   the acquisition task stalls too, for up to some 50 ms per sector
+   erase. The HX711 interrupt only keeps queueing conversions meanwhile
+   if the Arduino core registers it as an IRAM interrupt
+   (CONFIG_ARDUINO_ISR_IRAM), otherwise it is held back and the
+   conversions of that time are lost.
+   Only built with STORAGE_ESP32_FLASH defined on the ESP32 boards.
+*/
+#include "config.h"
+#if defined STORAGE_ESP32_FLASH && (defined TESTSTANDESP32 || defined TESTSTANDESP32V3)
+#include <esp_partition.h>
+#include "storage.h"
+
+#define ESP32_FLASH_SECTOR 4096
+#define ESP32_FLASH_PARTITION "curves"
+// the directory keeps 3 byte addresses
+#define ESP32_FLASH_MAX_CAPACITY 16777216UL
+
+class ESP32FlashStorage : public StorageDevice
+{
+  public:
+    ESP32FlashStorage(const char *label);
+    byte open();
+    byte read(unsigned long addr, byte *values, unsigned int nBytes);
+    byte write(unsigned long addr, byte *values, unsigned int nBytes);
+    byte writeAsync(unsigned long addr, byte *values, unsigned int nBytes);
+    byte poll();
+    bool isBusy();
+    void waitReady();
+    byte sync();
+    byte erase(unsigned long addr);
+    unsigned long getEraseSize();
+    void setCapacity(unsigned long capacity);
+    unsigned long getCapacity();
+
+  private:
+    const char *_label;
+    const esp_partition_t *_partition;
+    unsigned long _capacity;
+    // bytes _dirtyFrom to _dirtyTo of the sector at _sectorAddr are not
+    // written yet
+    uint8_t _sector[ESP32_FLASH_SECTOR];
+    unsigned long _sectorAddr;
+    uint16_t _dirtyFrom;
+    uint16_t _dirtyTo;
+    bool _syncPending;
+    byte _status;
+};
+
+#endif
+#endif
@@ -0,0 +1,170 @@
+#include "storage_file.h"
+
+#ifdef STORAGE_FILE
+#include <cstring>
+#include <chrono>
+#define FILE_STORAGE_CHUNK 256
+
+FileStorage::FileStorage(const char *path, unsigned long capacity, unsigned long eraseSize,
+                         unsigned long writeBytesPerMs, FileStorageClock clock)
+{
+  _path = path;
+  _file = NULL;
+  _capacity = capacity;
+  _eraseSize = eraseSize;
+  _writeBytesPerMs = writeBytesPerMs;
+  _clock = clock;
+  _busyUntil = 0;
+  _status = 0;
+}
+
+FileStorage::~FileStorage()
+{
+  if (_file != NULL)
+    std::fclose(_file);
+}
+
+unsigned long FileStorage::now()
+{
+  if (_clock != NULL)
+    return _clock();
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+   open()
+   open the file, a new one or a short one is filled up with 0xFF as a
+   blank memory
+*/
+uint8_t FileStorage::open()
+{
+  uint8_t blank[FILE_STORAGE_CHUNK];
+  long size;
+
+  if (_file != NULL)
+    std::fclose(_file);
+  _file = std::fopen(_path, "r+b");
+  if (_file == NULL)
+    _file = std::fopen(_path, "w+b");
+  if (_file == NULL)
+    return 2;
+  std::fseek(_file, 0, SEEK_END);
+  size = std::ftell(_file);
+  std::memset(blank, 0xFF, sizeof(blank));
+  while ((unsigned long)size < _capacity)
+  {
+    unsigned long n = _capacity - size < sizeof(blank) ? _capacity - size : sizeof(blank);
+    if (std::fwrite(blank, 1, n, _file) != n)
+      return 4;
+    size += n;
+  }
+  std::fflush(_file);
+  return 0;
+}
+
+uint8_t FileStorage::read(unsigned long addr, uint8_t *values, unsigned int nBytes)
+{
+  if (_file == NULL || addr + nBytes > _capacity)
+    return STORAGE_ADDR_ERR;
+  waitReady();
+  std::fseek(_file, addr, SEEK_SET);
+  if (std::fread(values, 1, nBytes, _file) != nBytes)
+    return 4;
+  return 0;
+}
+
+uint8_t FileStorage::writeAsync(unsigned long addr, uint8_t *values, unsigned int nBytes)
+{
+  uint8_t data[FILE_STORAGE_CHUNK];
+
+  if (isBusy())
+    return STORAGE_BUSY;
+  if (_file == NULL || addr + nBytes > _capacity)
+    return STORAGE_ADDR_ERR;
+  _status = 0;
+  for (unsigned int done = 0; done < nBytes; )
+  {
+    unsigned int n = nBytes - done < sizeof(data) ? nBytes - done : sizeof(data);
+    std::fseek(_file, addr + done, SEEK_SET);
+    if (std::fread(data, 1, n, _file) != n)
+      _status = 4;
+    for (unsigned int i = 0; i < n; i++)
+      data[i] = _eraseSize > 1 ? data[i] & values[done + i] : values[done + i];
+    std::fseek(_file, addr + done, SEEK_SET);
+    if (std::fwrite(data, 1, n, _file) != n)
+      _status = 4;
+    done += n;
+  }
+  std::fflush(_file);
+  if (_writeBytesPerMs > 0)
+    _busyUntil = now() + (nBytes + _writeBytesPerMs - 1) / _writeBytesPerMs;
+  return 0;
+}
+
+uint8_t FileStorage::write(unsigned long addr, uint8_t *values, unsigned int nBytes)
+{
+  uint8_t status;
+  waitReady();
+  status = writeAsync(addr, values, nBytes);
+  if (status != 0)
+    return status;
+  waitReady();
+  return _status;
+}
+
+uint8_t FileStorage::poll()
+{
+  if ((long)(now() - _busyUntil) < 0)
+    return STORAGE_BUSY;
+  return _status;
+}
+
+bool FileStorage::isBusy()
+{
+  return poll() == STORAGE_BUSY;
+}
+
+void FileStorage::waitReady()
+{
+  while (isBusy())
+    ;
+}
+
+uint8_t FileStorage::erase(unsigned long addr)
+{
+  uint8_t blank[FILE_STORAGE_CHUNK];
+  unsigned long block;
+
+  if (_file == NULL || addr >= _capacity)
+    return STORAGE_ADDR_ERR;
+  waitReady();
+  block = addr - addr % _eraseSize;
+  std::memset(blank, 0xFF, sizeof(blank));
+  std::fseek(_file, block, SEEK_SET);
+  for (unsigned long done = 0; done < _eraseSize; done += sizeof(blank))
+  {
+    unsigned long n = _eraseSize - done < sizeof(blank) ? _eraseSize - done : sizeof(blank);
+    if (std::fwrite(blank, 1, n, _file) != n)
+      return 4;
+  }
+  std::fflush(_file);
+  return 0;
+}
+
+unsigned long FileStorage::getEraseSize()
+{
+  return _eraseSize;
+}
+
+void FileStorage::setCapacity(unsigned long capacity)
+{
+  _capacity = capacity;
+}
+
+unsigned long FileStorage::getCapacity()
+{
+  return _capacity;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef _STORAGE_FILE_H
+#define _STORAGE_FILE_H
+/*
+   FileStorage
+   A file standing in for the memory when the logger is built on a
+   computer, to replay recordings or try a memory before buying it. It
+   only needs the C and C++ standard library, see host/CMakeLists.txt.
+   With an eraseSize above 1 it behaves like a flash: the writes can only
+   clear bits and erase() sets a block back to 0xFF.
+   writeBytesPerMs slows the writes down to the speed of the memory, the
+   write stays busy that long. 0 for no wait. The time comes from clock,
+   in ms, or from std::chrono::steady_clock if it is NULL.
+   Only built with STORAGE_FILE defined.
+*/
+#ifdef STORAGE_FILE
+#include <cstdio>
+#include <cstdint>
+#include "storage.h"
+
+typedef unsigned long (*FileStorageClock)();
+
+class FileStorage : public StorageDevice
+{
+  public:
+    FileStorage(const char *path, unsigned long capacity, unsigned long eraseSize = 1,
+                unsigned long writeBytesPerMs = 0, FileStorageClock clock = NULL);
+    ~FileStorage();
+    uint8_t open();
+    uint8_t read(unsigned long addr, uint8_t *values, unsigned int nBytes);
+    uint8_t write(unsigned long addr, uint8_t *values, unsigned int nBytes);
+    uint8_t writeAsync(unsigned long addr, uint8_t *values, unsigned int nBytes);
+    uint8_t poll();
+    bool isBusy();
+    void waitReady();
+    uint8_t erase(unsigned long addr);
+    unsigned long getEraseSize();
+    void setCapacity(unsigned long capacity);
+    unsigned long getCapacity();
+
+  private:
+    const char *_path;
+    std::FILE *_file;
+    unsigned long _capacity;
+    unsigned long _eraseSize;
+    unsigned long _writeBytesPerMs;
+    FileStorageClock _clock;
+    unsigned long _busyUntil;
+    uint8_t _status;
+    unsigned long now();
+};
+
+#endif
+#endif
@@ -0,0 +1,279 @@
+#include "storage_spi.h"
+
+static const SPISettings spiStorageSettings(SPI_STORAGE_CLOCK, MSBFIRST, SPI_MODE0);
+
+SPIStorage::SPIStorage(uint8_t csPin, unsigned long capacity, uint8_t addrBytes)
+{
+  _csPin = csPin;
+  _capacity = capacity;
+  _addrBytes = addrBytes;
+}
+
+void SPIStorage::begin()
+{
+  pinMode(_csPin, OUTPUT);
+  digitalWrite(_csPin, HIGH);
+  SPI.begin();
+}
+
+void SPIStorage::select()
+{
+  SPI.beginTransaction(spiStorageSettings);
+  digitalWrite(_csPin, LOW);
+}
+
+void SPIStorage::deselect()
+{
+  digitalWrite(_csPin, HIGH);
+  SPI.endTransaction();
+}
+
+/*
+   command()
+   a command on its own, such as write enable
+*/
+void SPIStorage::command(byte cmd)
+{
+  select();
+  SPI.transfer(cmd);
+  deselect();
+}
+
+/*
+   addressCommand()
+   send the command and the address, the memory stays selected for the
+   data that follows
+*/
+void SPIStorage::addressCommand(byte cmd, unsigned long addr)
+{
+  select();
+  SPI.transfer(cmd);
+  if (_addrBytes > 2)
+    SPI.transfer((byte)(addr >> 16));
+  SPI.transfer((byte)(addr >> 8));
+  SPI.transfer((byte)addr);
+}
+
+byte SPIStorage::read(unsigned long addr, byte *values, unsigned int nBytes)
+{
+  if (addr + nBytes > _capacity)
+    return STORAGE_ADDR_ERR;
+  waitReady();
+  addressCommand(SPI_CMD_READ, addr);
+  for (unsigned int i = 0; i < nBytes; i++)
+    values[i] = SPI.transfer(0);
+  deselect();
+  return 0;
+}
+
+void SPIStorage::setCapacity(unsigned long capacity)
+{
+  _capacity = capacity;
+}
+
+unsigned long SPIStorage::getCapacity()
+{
+  return _capacity;
+}
+
+/*
+   SPIFramStorage
+   the write is over when the memory is deselected
+*/
+SPIFramStorage::SPIFramStorage(uint8_t csPin, unsigned long capacity)
+  : SPIStorage(csPin, capacity, capacity > 65536UL ? 3 : 2)
+{
+  _status = 0;
+}
+
+byte SPIFramStorage::open()
+{
+  begin();
+  return 0;
+}
+
+byte SPIFramStorage::write(unsigned long addr, byte *values, unsigned int nBytes)
+{
+  if (addr + nBytes > _capacity)
+    return STORAGE_ADDR_ERR;
+  command(SPI_CMD_WREN);
+  addressCommand(SPI_CMD_WRITE, addr);
+  for (unsigned int i = 0; i < nBytes; i++)
+    SPI.transfer(values[i]);
+  deselect();
+  return 0;
+}
+
+byte SPIFramStorage::writeAsync(unsigned long addr, byte *values, unsigned int nBytes)
+{
+  _status = write(addr, values, nBytes);
+  return _status;
+}
+
+byte SPIFramStorage::poll()
+{
+  return _status;
+}
+
+bool SPIFramStorage::isBusy()
+{
+  return false;
+}
+
+void SPIFramStorage::waitReady()
+{
+}
+
+/*
+   SPINorStorage
+   A page program or a sector erase runs in the flash while we go on,
+   poll() reads the status register until it is over and programs the
+   next page of the write if there is one
+*/
+SPINorStorage::SPINorStorage(uint8_t csPin)
+  : SPIStorage(csPin, 0, 3)
+{
+  _busy = false;
+  _status = 0;
+  _wBytes = 0;
+}
+
+/*
+   open()
+   wake the flash up and take its size from the JEDEC id
+*/
+byte SPINorStorage::open()
+{
+  byte id[3];
+  begin();
+  command(SPI_CMD_RELEASE_PD);
+  delayMicroseconds(50);
+  select();
+  SPI.transfer(SPI_CMD_JEDEC_ID);
+  for (uint8_t i = 0; i < 3; i++)
+    id[i] = SPI.transfer(0);
+  deselect();
+  // nobody there
+  if (id[0] == 0x00 || id[0] == 0xFF)
+    return 2;
+  _capacity = SPI_NOR_MAX_CAPACITY;
+  if (id[2] >= 16 && id[2] < 24)
+    _capacity = 1UL << id[2];
+  return 0;
+}
+
+byte SPINorStorage::readStatus()
+{
+  select();
+  SPI.transfer(SPI_CMD_RDSR);
+  byte status = SPI.transfer(0);
+  deselect();
+  return status;
+}
+
+/*
+   programPage()
+   start programming what is left of the write, up to the end of the page
+*/
+void SPINorStorage::programPage()
+{
+  unsigned int n = SPI_NOR_PAGE - (_wAddr & (SPI_NOR_PAGE - 1));
+  if (n > _wBytes)
+    n = _wBytes;
+  command(SPI_CMD_WREN);
+  addressCommand(SPI_CMD_WRITE, _wAddr);
+  for (unsigned int i = 0; i < n; i++)
+    SPI.transfer(_wValues[i]);
+  deselect();
+  _wAddr += n;
+  _wValues += n;
+  _wBytes -= n;
+  _wStart = millis();
+  _wTimeout = SPI_NOR_PROGRAM_TIMEOUT_MS;
+}
+
+byte SPINorStorage::writeAsync(unsigned long addr, byte *values, unsigned int nBytes)
+{
+  if (_busy)
+    return STORAGE_BUSY;
+  if (addr + nBytes > _capacity)
+    return STORAGE_ADDR_ERR;
+  _wAddr = addr;
+  _wValues = values;
+  _wBytes = nBytes;
+  _status = 0;
+  if (nBytes == 0)
+    return 0;
+  _busy = true;
+  programPage();
+  return 0;
+}
+
+byte SPINorStorage::poll()
+{
+  if (!_busy)
+    return _status;
+  if (readStatus() & SPI_SR_WIP)
+  {
+    if (millis() - _wStart <= _wTimeout)
+      return STORAGE_BUSY;
+    _status = STORAGE_TIMEOUT;
+    _busy = false;
+    return _status;
+  }
+  if (_wBytes > 0)
+  {
+    programPage();
+    return STORAGE_BUSY;
+  }
+  _busy = false;
+  return _status;
+}
+
+byte SPINorStorage::write(unsigned long addr, byte *values, unsigned int nBytes)
+{
+  byte status;
+  waitReady();
+  status = writeAsync(addr, values, nBytes);
+  if (status != 0)
+    return status;
+  while ((status = poll()) == STORAGE_BUSY)
+    ;
+  return status;
+}
+
+bool SPINorStorage::isBusy()
+{
+  return poll() == STORAGE_BUSY;
+}
+
+void SPINorStorage::waitReady()
+{
+  while (isBusy())
+    ;
+}
+
+/*
+   erase()
+   start erasing the sector of addr, it takes tens of ms
+*/
+byte SPINorStorage::erase(unsigned long addr)
+{
+  if (addr >= _capacity)
+    return STORAGE_ADDR_ERR;
+  waitReady();
+  command(SPI_CMD_WREN);
+  addressCommand(SPI_CMD_SECTOR_ERASE, addr & ~(SPI_NOR_SECTOR - 1UL));
+  deselect();
+  _wBytes = 0;
+  _status = 0;
+  _busy = true;
+  _wStart = millis();
+  _wTimeout = SPI_NOR_ERASE_TIMEOUT_MS;
+  return 0;
+}
+
+unsigned long SPINorStorage::getEraseSize()
+{
+  return SPI_NOR_SECTOR;
+}
@@ -0,0 +1,93 @@
+#ifndef _STORAGE_SPI_H
+#define _STORAGE_SPI_H
+/*
+   SPI memories for the thrust curves
+
+   SPIFramStorage: FRAM such as the MB85RS64V to MB85RS2MT, the bytes are
+   written at SPI speed with no write cycle to wait for.
+   SPINorStorage: NOR flash such as the W25Q or the GD25Q, megabytes that
+   must be erased by 4KB sectors. Its size is read from its JEDEC id.
+*/
+#include <Arduino.h>
+#include <SPI.h>
+#include "storage.h"
+
+#define SPI_STORAGE_CLOCK 20000000
+
+#define SPI_CMD_WREN 0x06
+#define SPI_CMD_RDSR 0x05
+#define SPI_CMD_READ 0x03
+#define SPI_CMD_WRITE 0x02          // page program for the NOR flash
+#define SPI_CMD_SECTOR_ERASE 0x20
+#define SPI_CMD_JEDEC_ID 0x9F
+#define SPI_CMD_RELEASE_PD 0xAB
+#define SPI_SR_WIP 0x01
+
+#define SPI_NOR_PAGE 256
+#define SPI_NOR_SECTOR 4096
+// the logger and the 0x03 read command use 3 address bytes
+#define SPI_NOR_MAX_CAPACITY 16777216UL
+#define SPI_NOR_PROGRAM_TIMEOUT_MS 5
+#define SPI_NOR_ERASE_TIMEOUT_MS 500
+
+class SPIStorage : public StorageDevice
+{
+  public:
+    SPIStorage(uint8_t csPin, unsigned long capacity, uint8_t addrBytes);
+    byte read(unsigned long addr, byte *values, unsigned int nBytes);
+    void setCapacity(unsigned long capacity);
+    unsigned long getCapacity();
+
+  protected:
+    uint8_t _csPin;
+    unsigned long _capacity;
+    uint8_t _addrBytes;
+    void begin();
+    void select();
+    void deselect();
+    void command(byte cmd);
+    void addressCommand(byte cmd, unsigned long addr);
+};
+
+class SPIFramStorage : public SPIStorage
+{
+  public:
+    SPIFramStorage(uint8_t csPin, unsigned long capacity);
+    byte open();
+    byte write(unsigned long addr, byte *values, unsigned int nBytes);
+    byte writeAsync(unsigned long addr, byte *values, unsigned int nBytes);
+    byte poll();
+    bool isBusy();
+    void waitReady();
+
+  private:
+    byte _status;
+};
+
+class SPINorStorage : public SPIStorage
+{
+  public:
+    SPINorStorage(uint8_t csPin);
+    byte open();
+    byte write(unsigned long addr, byte *values, unsigned int nBytes);
+    byte writeAsync(unsigned long addr, byte *values, unsigned int nBytes);
+    byte poll();
+    bool isBusy();
+    void waitReady();
+    byte erase(unsigned long addr);
+    unsigned long getEraseSize();
+
+  private:
+    // write or erase in progress
+    bool _busy;
+    byte _status;
+    byte *_wValues;
+    unsigned long _wAddr;
+    unsigned int _wBytes;
+    unsigned long _wStart;
+    unsigned long _wTimeout;
+    byte readStatus();
+    void programPage();
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "trigger.h"
+
+static uint8_t state = TRIGGER_ARMED;
+static long endThrust;
+// ms spent under endThrust
+static long belowTime;
+// the thrust went over endThrust since the arming, a burnout can only
+// come after that
+static boolean burnSeen;
+
+/*
+   triggerArm()
+   wait for the thrust to rise, call it before the first sample. The end
+   threshold is lowered to leave the hysteresis under the start one
+*/
+void triggerArm()
+{
+  endThrust = config.endRecordThrust;
+  if (config.startRecordThrust > 0)
+  {
+    long band = (long)config.startRecordThrust * TRIGGER_HYSTERESIS / 100;
+    if (band < TRIGGER_HYSTERESIS_MIN)
+      band = TRIGGER_HYSTERESIS_MIN;
+    if (endThrust > config.startRecordThrust - band)
+      endThrust = config.startRecordThrust - band;
+  }
+  belowTime = 0;
+  burnSeen = false;
+  state = TRIGGER_ARMED;
+}
+
+/*
+   triggerUpdate()
+   follow the thrust of a sample taken diffTime ms after the previous one,
+   returns the new state
+*/
+uint8_t triggerUpdate(long thrust, long diffTime)
+{
+  switch (state)
+  {
+    case TRIGGER_ARMED:
+      if (config.startRecordThrust <= 0 || thrust > config.startRecordThrust)
+      {
+        burnSeen = thrust >= endThrust;
+        state = TRIGGER_BURNING;
+      }
+      break;
+    case TRIGGER_BURNING:
+      // started at once on the idle stand, wait for the thrust to rise
+      if (thrust >= endThrust)
+        burnSeen = true;
+      else if (config.burnoutHoldOff > 0 && burnSeen)
+      {
+        belowTime = 0;
+        state = TRIGGER_BURNOUT;
+      }
+      break;
+    case TRIGGER_BURNOUT:
+      if (thrust >= endThrust)
+        state = TRIGGER_BURNING;
+      else
+      {
+        belowTime += diffTime;
+        if (belowTime >= config.burnoutHoldOff)
+          state = TRIGGER_STOPPED;
+      }
+      break;
+  }
+  return state;
+}
+
+uint8_t triggerState()
+{
+  return state;
+}
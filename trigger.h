@@ -0,0 +1,33 @@
+#ifndef _TRIGGER_H
+#define _TRIGGER_H
+/*
+   Start and end of the burn
+
+   triggerUpdate() is given the thrust of every sample. Armed, it starts
+   the recording once the thrust goes over config.startRecordThrust, 0 to
+   start at once. It stops it once the thrust has stayed under
+   config.endRecordThrust for config.burnoutHoldOff ms, 0 to only stop at
+   config.endRecordTime. Started at once, the thrust has to reach the end
+   threshold before the recording can stop, so an idle stand records up
+   to config.endRecordTime. The end threshold is kept at least
+   TRIGGER_HYSTERESIS percent, and TRIGGER_HYSTERESIS_MIN, under the
+   start one so that the noise around a threshold cannot start and stop
+   the recording.
+*/
+#include "config.h"
+#include "Arduino.h"
+
+#define TRIGGER_ARMED 0
+#define TRIGGER_BURNING 1
+#define TRIGGER_BURNOUT 2     // under the end threshold for less than the hold-off
+#define TRIGGER_STOPPED 3
+
+// smallest gap between the start and the end thresholds, in percent of
+// the start one and in the unit of the thrust
+#define TRIGGER_HYSTERESIS 10
+#define TRIGGER_HYSTERESIS_MIN 1
+
+extern void triggerArm();
+extern uint8_t triggerUpdate(long thrust, long diffTime);
+extern uint8_t triggerState();
+#endif